@@ -3,6 +3,7 @@
 
 #include "constants.hpp"
 
+#include <atomic>
 #include <utility>
 
 class CircularRWBufferBase {
@@ -14,24 +15,38 @@ public:
   enum class State { Empty, Normal, Full };
 };
 
+// Byte ring for exactly one writer thread and one reader thread. Writes are
+// staged and only become visible to the reader on `commit`, so the reader never
+// sees half of what was written in one go.
 class CircularRWBuffer : CircularRWBufferBase {
 public:
+  static constexpr size_t BUFSIZE = 1024;
+
+  // Writer only
   template <typename... Args>
   void write(const Args... datas);
 
+  // Writer only
+  void commit();
+
+  // Writer only; counts staged bytes as written
+  const size_t get_num_writable() const;
+
+  // Reader only
   const u8 read();
 
+  // Reader only; committed bytes not yet read
   const State get_state() const;
 
 private:
-  static constexpr size_t BUFSIZE = 128;
+  static_assert((BUFSIZE & (BUFSIZE - 1)) == 0, "BUFSIZE must be a power of 2");
 
   void write_impl(const u8 data);
 
   u8 buffer[BUFSIZE] = {0};
-  size_t r_ptr_offset = 0;
-  size_t w_ptr_offset = 0;
-  State state = State::Empty;
+  size_t staged_w_ptr_offset = 0; // writer only
+  alignas(64) std::atomic<size_t> r_ptr_offset{0};
+  alignas(64) std::atomic<size_t> w_ptr_offset{0};
 };
 
 template <typename... Args>
@@ -40,51 +55,49 @@ void CircularRWBuffer::write(const Args... datas)
   (write_impl(std::forward<const Args>(datas)), ...);
 }
 
-const u8 CircularRWBuffer::read()
+inline void CircularRWBuffer::commit()
 {
-  if (state == State::Empty) {
-    throw ReadError::BufferEmpty;
-  }
-
-  const u8 result = *(buffer + r_ptr_offset);
+  w_ptr_offset.store(staged_w_ptr_offset, std::memory_order_release);
+}
 
-  if (++r_ptr_offset >= BUFSIZE) {
-    r_ptr_offset = 0;
-  }
+inline const size_t CircularRWBuffer::get_num_writable() const
+{
+  return BUFSIZE -
+    (staged_w_ptr_offset - r_ptr_offset.load(std::memory_order_acquire));
+}
 
-  if (r_ptr_offset == w_ptr_offset) {
-    state = State::Empty;
-  }
-  else {
-    state = State::Normal;
+inline const u8 CircularRWBuffer::read()
+{
+  const size_t r_ptr_offset =
+    this->r_ptr_offset.load(std::memory_order_relaxed);
+  if (r_ptr_offset == w_ptr_offset.load(std::memory_order_acquire)) {
+    throw ReadError::BufferEmpty;
   }
 
+  const u8 result = buffer[r_ptr_offset & (BUFSIZE - 1)];
+  this->r_ptr_offset.store(r_ptr_offset + 1, std::memory_order_release);
   return result;
 }
 
-const CircularRWBufferBase::State CircularRWBuffer::get_state() const
+inline const CircularRWBufferBase::State
+CircularRWBuffer::get_state() const
 {
-  return state;
+  const size_t size = w_ptr_offset.load(std::memory_order_acquire) -
+    r_ptr_offset.load(std::memory_order_relaxed);
+  if (size == 0) {
+    return State::Empty;
+  }
+  return size == BUFSIZE ? State::Full : State::Normal;
 }
 
-void CircularRWBuffer::write_impl(const u8 data)
+inline void CircularRWBuffer::write_impl(const u8 data)
 {
-  if (state == State::Full) {
+  if (get_num_writable() == 0) {
     throw WriteError::BufferFull;
   }
 
-  *(buffer + w_ptr_offset) = data;
-
-  if (++w_ptr_offset >= BUFSIZE) {
-    w_ptr_offset = 0;
-  }
-
-  if (w_ptr_offset == r_ptr_offset) {
-    state = State::Full;
-  }
-  else {
-    state = State::Normal;
-  }
+  buffer[staged_w_ptr_offset & (BUFSIZE - 1)] = data;
+  ++staged_w_ptr_offset;
 }
 
 #endif
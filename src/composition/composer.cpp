@@ -0,0 +1,96 @@
+#include "composer.hpp"
+
+#include <chrono>
+#include <cmath>
+
+Composer::Composer(imp_song& song, const f64 lookahead_beats)
+  : song(song), lookahead_beats(lookahead_beats)
+{
+}
+
+void Composer::compose()
+{
+  for (u32 ix = 0; ix != IMP_NUM_INSTRUMENT_INSTANCES; ++ix) {
+    imp_instrument_instance& instrument_instance =
+      song.instrument_instances[ix];
+    if (instrument_instance.scale.size == 0) {
+      continue;
+    }
+
+    auto& events = instrument_instance.queue;
+    const f64 num_beats_consumed =
+      instrument_instance.num_beats_consumed.load(std::memory_order_relaxed);
+    while (num_beats_composed[ix] - num_beats_consumed < lookahead_beats &&
+           events.get_num_writable() >= MAX_PHRASE_SIZE) {
+      num_beats_composed[ix] += generate_phrase(instrument_instance);
+      events.commit();
+    }
+  }
+}
+
+void Composer::start()
+{
+  if (thread.joinable()) {
+    return;
+  }
+  stopping = false;
+  thread = std::thread(&Composer::loop, this);
+}
+
+void Composer::stop()
+{
+  if (!thread.joinable()) {
+    return;
+  }
+  stopping = true;
+  thread.join();
+}
+
+void Composer::loop()
+{
+  while (!stopping) {
+    compose();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+const f64
+Composer::generate_phrase(imp_instrument_instance& instrument_instance)
+{
+  auto& events = instrument_instance.queue;
+  imp_scale scale = instrument_instance.scale;
+  u8 scale_root = instrument_instance.scale_root;
+  Pcg32& rng = instrument_instance.rng;
+  f64 num_beats = .0;
+
+  // Generate future events from plan
+  u8 note = imp_note(
+    IMP_NOTE(scale_rand(scale, scale_root, rng)),
+    IMP_OCTAVE(IMP_OCTAVE_MINUS_1 + rng.next_below(2)));
+  u8 subdiv1 = pow(2, rng.next_below(2)); // ∈ { 1, 2 }
+  for (u32 i = 0; i < subdiv1; ++i) {
+    u8 subdiv2 = pow(2, rng.next_below(4)); // ∈ { 1, 2, 4, 8 }
+    using F = u8 (*)(imp_scale, u8, u8);
+    F move_func = rng.next_below(2) == 0 ? scale_ascend : scale_descend;
+    for (u32 j = 0; j < subdiv2; ++j) {
+
+      u8 subdiv = subdiv1 * subdiv2;
+      if (rng.next_below(3)) {
+        note = move_func(scale, scale_root, note);
+        events.write(
+          rng.next_below(2) ? IMP_EVENT_TYPE_STRIKE : IMP_EVENT_TYPE_SLIDE,
+          // IMP_EVENT_TYPE_STRIKE,
+          note,
+          1,
+          subdiv,
+          IMP_EVENT_TYPE_RELEASE,
+          note);
+      }
+      else {
+        events.write(IMP_EVENT_TYPE_WAIT, 1, subdiv);
+      }
+      num_beats += 4. / subdiv;
+    }
+  }
+  return num_beats;
+}
@@ -0,0 +1,51 @@
+#ifndef IMP_COMPOSER
+#define IMP_COMPOSER
+
+#include "constants.hpp"
+#include "song.hpp"
+
+#include <atomic>
+#include <thread>
+
+// Generates phrases for every instrument instance that has a scale, keeping
+// its event queue at least `lookahead_beats` beats ahead of what the renderer
+// has consumed. Event queues have a single writer and a single reader, so the
+// composer can run on its own thread while another renders; the renderer then
+// only ever consumes events.
+class Composer {
+public:
+  static constexpr f64 DEFAULT_LOOKAHEAD_BEATS = 8.;
+
+  Composer(imp_song& song, const f64 lookahead_beats = DEFAULT_LOOKAHEAD_BEATS);
+  Composer(const Composer&) = delete;
+  Composer& operator=(const Composer&) = delete;
+  ~Composer() { stop(); }
+
+  // Tops up every event queue once, on the calling thread. Rendering
+  // deterministically means calling this before rendering each buffer of at
+  // most `lookahead_beats` beats instead of running the composer thread.
+  void compose();
+
+  // Starts / stops topping up event queues periodically on a thread of its
+  // own
+  void start();
+  void stop();
+
+private:
+  // Longest phrase generate_phrase writes
+  static constexpr size_t MAX_PHRASE_SIZE = 16 * 6;
+
+  // Returns how many beats the phrase lasts
+  const f64 generate_phrase(imp_instrument_instance& instrument_instance);
+
+  void loop();
+
+  imp_song& song;
+  const f64 lookahead_beats;
+  f64 num_beats_composed[IMP_NUM_INSTRUMENT_INSTANCES] = {};
+
+  std::atomic<bool> stopping{false};
+  std::thread thread;
+};
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef IMP_SONG
+#define IMP_SONG
+
+#include "circular_rw_buffer.hpp"
+#include "constants.hpp"
+#include "random.hpp"
+#include "synthesis/synth.hpp"
+#include "time_state.hpp"
+
+#include <atomic>
+
+// The frequencies for all MIDI notes
+inline constexpr f64 imp_note_freqs[] = {
+  8.17579891564368, // C-1 (First MIDI note)
+  8.66195721802722, // Db-1
+  9.17702399741896, // D-1
+  9.722718241315,   // Eb-1
+  10.3008611535272, // E-1
+  10.9133822322813, // F-1
+  11.5623257097385, // Gb-1
+  12.2498573744296, // G-1
+  12.9782717993732, // Ab-1
+  13.75,            // A-1
+  14.5676175474403, // Bb-1
+  15.4338531642538, // B-1
+  16.3515978312874, // C0
+  17.3239144360545, // Db0
+  18.6540479948379, // D0
+  19.44543648263,   // Eb0
+  20.6017223070543, // E0
+  21.8567644645627, // F0
+  23.1246514194771, // Gb0
+  24.4997147488593, // G0
+  25.9565435987465, // Ab0
+  27.5,             // A0 (Piano low A)
+  29.1352350948806, // Bb0
+  30.8677063285077, // B0 (5-string bass low open B)
+  32.7031956625748, // C1
+  34.6478288721089, // Db1
+  36.7080959896759, // D1
+  38.89087296526,   // Eb1
+  41.2034446141087, // E1 (4-string bass low open E)
+  43.6535289291254, // F1
+  46.2493028389542, // Gb1
+  48.9994294977186, // G1
+  51.913087197493,  // Ab1
+  55.,              // A1
+  58.2704701897611, // B1
+  61.7354126570154, // B1
+  65.4063913251495, // C2
+  69.2956577442179, // Db2
+  73.4161919793518, // D2
+  77.7817459305201, // Eb2
+  82.4068892282174, // E2 (Guitar low open E)
+  87.3070578582508, // F2
+  92.4986056779085, // Gb2
+  97.9988589954372, // G2 (4 or 5 string bass, high open G)
+  103.826174394986, // Ab2
+  110.,             // A2 (Guitar 5th string open)
+  116.540940379522, // Bb2
+  123.470825314031, // B2
+  130.812782650299, // C3 (6-string bass, high open C)
+  138.591315488436, // Db3
+  146.832383958704, // D3 (Guitar 4th string open)
+  155.56349186104,  // Eb3
+  164.813778456435, // E3
+  174.614115716502, // F3
+  184.997211355817, // Gb3
+  195.997717990874, // G3 (Guitar 3rd string open) (Violin low open G)
+  207.652348789972, // Ab3
+  220.,             // A3
+  233.081880759045, // Bb3
+  246.941650628062, // B3 (Guitar 3rd string open)
+  261.625565300599, // C4 (Piano middle C)
+  277.182630976872, // Db4
+  293.664767917407, // D4 (Violin 3rd string open)
+  311.126983722081, // Eb4
+  329.62755691287,  // E4 (Guitar 1st string open)
+  349.228231433004, // F4
+  369.994422711634, // Gb4
+  391.995435981749, // G4
+  415.304697579945, // Ab4
+  440.,             // A4 (Tuning fork A) (Violin 2nd string open)
+  466.16376151809,  // Bb4
+  493.883301256124, // B4
+  523.251130601197, // C5
+  554.365261953744, // Db5
+  587.329535834815, // D5
+  622.253967444162, // Eb5
+  659.25511382574,  // E5 (Guitar 1st string 12 fret) (Violin 1st string open)
+  698.456462866008, // F5
+  739.988845423269, // Gb5
+  783.990871963499, // G5
+  830.609395159891, // Ab5
+  880.,             // A5
+  932.32752303618,  // Bb5
+  987.766602512249, // B5
+  1046.50226120239, // C6
+  1108.73052390749, // Db6
+  1174.65907166963, // D6
+  1244.50793488832, // Eb6
+  1318.51022765148, // E6 (Guitar 1st string 24 fret)
+  1396.91292573202, // F6
+  1479.97769084654, // Gb6
+  1567.981743927,   // G6
+  1661.21879031978, // Ab6
+  1760.,            // A6
+  1864.65504607236, // Bb6
+  1975.5332050245,  // B6
+  2093.00452240479, // C7
+  2217.46104781498, // Db7
+  2349.31814333926, // D7
+  2489.01586977665, // Eb7
+  2637.02045530296, // E7
+  2793.82585146403, // F7
+  2959.95538169308, // Gb7
+  3135.963487854,   // G7
+  3322.43758063956, // Ab7
+  3520.,            // A7
+  3729.31009214472, // Bb7
+  3951.066410049,   // B7
+  4186.00904480958, // C8 (Piano upper C)
+  4434.92209562996, // Db8
+  4698.63628667853, // D8
+  4978.0317395533,  // Eb8
+  5274.04091060593, // E8
+  5587.65170292807, // F8
+  5919.91076338616, // Gb8
+  6271.926975708,   // G8
+  6644.87516127913, // Ab8
+  7040.00000000001, // A8
+  7458.62018428945, // Bb8
+  7902.132820098,   // B8
+  8372.01808961917, // C9
+  8869.84419125992, // Db9
+  9397.27257335706, // D9
+  9956.06347910661, // Eb9
+  10548.0818212119, // E9
+  11175.3034058561, // F9
+  11839.8215267723, // Gb9
+  12543.853951416,  // G9 (Last MIDI note)
+};
+
+// Enums //////////////////////////////////////////////////////////////////////
+
+enum IMP_OCTAVE : u8 {
+  IMP_OCTAVE_MINUS_5,
+  IMP_OCTAVE_MINUS_4,
+  IMP_OCTAVE_MINUS_3,
+  IMP_OCTAVE_MINUS_2,
+  IMP_OCTAVE_MINUS_1,
+  IMP_OCTAVE_ZERO,
+  IMP_OCTAVE_PLUS_1,
+  IMP_OCTAVE_PLUS_2,
+  IMP_OCTAVE_PLUS_3,
+  IMP_OCTAVE_PLUS_4,
+  IMP_OCTAVE_PLUS_5,
+};
+
+enum IMP_NOTE : u8 {
+  IMP_NOTE_C,
+  IMP_NOTE_CSHARP,
+  IMP_NOTE_D,
+  IMP_NOTE_DSHARP,
+  IMP_NOTE_E,
+  IMP_NOTE_F,
+  IMP_NOTE_FSHARP,
+  IMP_NOTE_G,
+  IMP_NOTE_GSHARP,
+  IMP_NOTE_A,
+  IMP_NOTE_ASHARP,
+  IMP_NOTE_B,
+};
+
+// enum IMP_ABSTRACT_INTERVAL : u8 {
+//     IMP_ABSTRACT_INTERVAL_UNISON,
+//     IMP_ABSTRACT_INTERVAL_SECOND,
+//     IMP_ABSTRACT_INTERVAL_THIRD,
+//     IMP_ABSTRACT_INTERVAL_FOURTH,
+//     IMP_ABSTRACT_INTERVAL_FIFTH,
+//     IMP_ABSTRACT_INTERVAL_SIXTH,
+//     IMP_ABSTRACT_INTERVAL_SEVENTH,
+//     IMP_ABSTRACT_INTERVAL_OCTAVE,
+//     IMP_ABSTRACT_INTERVAL_NINTH,
+//     IMP_ABSTRACT_INTERVAL_TENTH,
+//     IMP_ABSTRACT_INTERVAL_ELEVENTH,
+//     IMP_ABSTRACT_INTERVAL_TWELVTH,
+//     IMP_ABSTRACT_INTERVAL_THIRTEENTH,
+//     IMP_ABSTRACT_INTERVAL_FOURTEENTH,
+//     IMP_ABSTRACT_INTERVAL_DOUBLE_OCTAVE,
+// };
+
+// enum IMP_INTERVAL : u8 {
+//     IMP_INTERVAL_UNISON,
+//     IMP_INTERVAL_MINOR_SECOND,
+//     IMP_INTERVAL_MAJOR_SECOND,
+//     IMP_INTERVAL_MINOR_THIRD,
+//     IMP_INTERVAL_MAJOR_THIRD,
+//     IMP_INTERVAL_PERFECT_FOURTH,
+//     IMP_INTERVAL_TRITONE,
+//     IMP_INTERVAL_PERFECT_FIFTH,
+//     IMP_INTERVAL_MINOR_SIXTH,
+//     IMP_INTERVAL_MAJOR_SIXTH,
+//     IMP_INTERVAL_MINOR_SEVENTH,
+//     IMP_INTERVAL_MAJOR_SEVENTH,
+// };
+
+enum IMP_EVENT_TYPE : u8 {
+  IMP_EVENT_TYPE_STRIKE,  // note
+  IMP_EVENT_TYPE_RELEASE, // note
+  IMP_EVENT_TYPE_SLIDE,   // note
+  // IMP_EVENT_TYPE_VIBRATO, // amp, period
+  IMP_EVENT_TYPE_WAIT, // wait, subdiv
+  // IMP_EVENT_TYPE_SET_TIME_SIGNATURE, // top, bottom
+  // IMP_EVENT_TYPE_CHORD, // note, type
+};
+
+// Structs ////////////////////////////////////////////////////////////////////
+
+struct imp_scale {
+  u8 size;
+  u8* ixs;
+};
+
+// struct imp_time_sig {
+//     u8 top;
+//     u8 btm;
+// };
+
+struct imp_instrument_instance {
+  bool active;
+  Synth* synth;
+  imp_scale scale;
+  u8 scale_root;
+  u64 e_tick; // when the next event is due, see TimeState::get_tick
+  CircularRWBuffer queue; // written by the composer, read by the renderer
+  std::atomic<f64> num_beats_consumed{.0}; // only written by the renderer
+  Pcg32 rng; // only touched by the composer
+};
+
+struct imp_song {
+  f64 bpm;
+  // u8 *form;
+  imp_instrument_instance* instrument_instances;
+  TimeState time_state;
+};
+
+// Helper functions ///////////////////////////////////////////////////////////
+
+inline u8 imp_note(IMP_NOTE note, IMP_OCTAVE octave)
+{
+  return octave * 12 + note;
+}
+
+// TODO scale_rel_ix_up / scale_rel_ix_down instead, like in ground ??
+/// Find relative index in scale
+/// example:
+/// scale_note 5
+/// scale_ix 0  1  2
+/// scale    2  4  6
+/// offsets -3 -1 +1
+/// returns 1
+inline bool
+scale_rel_ix(imp_scale scale, u8 scale_root, u8 note, u8* scale_ix, i8* offset)
+{
+  i8 scale_note = (note + 12 - scale_root) % 12;
+  *offset = 100; // init with unreasonably high offset
+  for (u32 i = 0; i != scale.size; ++i) {
+    i8 curr_offset = i8(scale.ixs[i]) - scale_note;
+    if (curr_offset == 0) {
+      *offset = 0;
+      *scale_ix = i;
+      return true;
+    }
+    // no equality check, in order to prefer lower note (unless scale ixs goes
+    // down for stupid reason)
+    else if ((curr_offset * curr_offset < *offset * *offset)) {
+      *offset = curr_offset;
+      *scale_ix = i;
+    }
+  }
+  return false;
+}
+
+inline u8 scale_descend(imp_scale scale, u8 scale_root, u8 origin)
+{
+  u32 last_index = scale.size - 1;
+
+  u8 root_rel = (origin + 12 - scale_root) % 12;
+
+  if (root_rel == 0) {
+    return origin + scale.ixs[last_index] - 12 - root_rel; // TODO bound
+  }
+
+  for (i32 i = last_index; i >= 0; --i) {
+    if (scale.ixs[i] < root_rel) {
+      return origin + scale.ixs[i] - root_rel; // TODO bound
+    }
+  }
+
+  throw "invariant broken: logic faulty"; // TODO (fix): STL exception?
+}
+
+inline u8 scale_ascend(imp_scale scale, u8 scale_root, u8 origin)
+{
+  u8 root_rel = (origin + 12 - scale_root) % 12;
+
+  for (u32 i = 0; i != scale.size; ++i) {
+    if (scale.ixs[i] > root_rel) {
+      return origin + scale.ixs[i] - root_rel; // TODO bound
+    }
+  }
+
+  return origin + 12 - root_rel; // TODO bound
+}
+
+inline u8 scale_rand(imp_scale scale, u8 scale_root, Pcg32& rng)
+{
+  return (scale_root + scale.ixs[rng.next_below(scale.size)]) % 12;
+}
+
+#endif
@@ -22,11 +22,24 @@ typedef int64_t i64;
 typedef float f32;
 typedef double f64;
 
+// Sample type of the render path (voices, wavetables, envelopes and mixing).
+// f32 doubles the SIMD width and halves the wavetable footprint, at a
+// precision which is still plenty for 16 bit output. Time stays f64.
+#ifdef IMP_SAMPLE_F32
+typedef f32 sample_t;
+#else
+typedef f64 sample_t;
+#endif
+
 // Static data ////////////////////////////////////////////////////////////////
 
 constexpr f64 IMP_SAMPLE_FREQ = 44100.;
 constexpr f64 IMP_INV_SAMPLE_FREQ = 1. / IMP_SAMPLE_FREQ;
 
+// Number of frames rendered per block; events are applied at frame accuracy by
+// splitting blocks, everything else (e.g. time scale) updates at block rate
+constexpr u32 IMP_BLOCK_SIZE = 64;
+
 constexpr size_t IMP_NUM_SYNTHS = 16;
 constexpr size_t IMP_NUM_INSTRUMENT_INSTANCES = 64;
 
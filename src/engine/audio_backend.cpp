@@ -0,0 +1,94 @@
+#include "audio_backend.hpp"
+
+#include "backends/alsa_backend.hpp"
+#include "backends/file_backend.hpp"
+#include "backends/fmod_backend.hpp"
+#include "backends/null_backend.hpp"
+#include "backends/pipe_backend.hpp"
+#include "math.hpp"
+
+#include <cstring>
+
+const bool
+StreamBackend::start(const RenderCallback callback, void* context)
+{
+  stop();
+  if (!open()) {
+    return false;
+  }
+  stopping = false;
+  running = true;
+  thread = std::thread(&StreamBackend::loop, this, callback, context);
+  return true;
+}
+
+void StreamBackend::stop()
+{
+  if (!thread.joinable()) {
+    return;
+  }
+  stopping = true;
+  thread.join();
+  close();
+}
+
+void StreamBackend::loop(const RenderCallback callback, void* context)
+{
+  sample_t frames[FRAMES_PER_CALLBACK];
+  while (!stopping) {
+    callback(context, frames, FRAMES_PER_CALLBACK);
+    if (!write(frames, FRAMES_PER_CALLBACK)) {
+      break;
+    }
+  }
+  running = false;
+}
+
+void interleave_pcm16(
+  const sample_t* frames,
+  const u32 num_frames,
+  const u16 num_channels,
+  i16* out)
+{
+  for (u32 i = 0; i != num_frames; ++i) {
+    const i16 val = i16(clamp(-1., 1., f64(frames[i])) * 32767.);
+    for (u16 c = 0; c != num_channels; ++c) {
+      *out++ = val;
+    }
+  }
+}
+
+std::unique_ptr<AudioBackend>
+create_audio_backend(const char* name, const char* path)
+{
+  if (name == nullptr) {
+#if defined(IMP_WITH_FMOD)
+    name = "fmod";
+#elif defined(IMP_WITH_ALSA)
+    name = "alsa";
+#else
+    name = "pipe";
+#endif
+  }
+
+  if (strcmp(name, "null") == 0) {
+    return std::make_unique<NullBackend>();
+  }
+  if (strcmp(name, "file") == 0) {
+    return std::make_unique<FileBackend>(path);
+  }
+  if (strcmp(name, "pipe") == 0) {
+    return std::make_unique<PipeBackend>(path);
+  }
+#ifdef IMP_WITH_ALSA
+  if (strcmp(name, "alsa") == 0) {
+    return std::make_unique<AlsaBackend>();
+  }
+#endif
+#ifdef IMP_WITH_FMOD
+  if (strcmp(name, "fmod") == 0) {
+    return std::make_unique<FmodBackend>();
+  }
+#endif
+  return nullptr;
+}
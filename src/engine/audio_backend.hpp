@@ -0,0 +1,74 @@
+#ifndef IMP_AUDIO_BACKEND
+#define IMP_AUDIO_BACKEND
+
+#include "constants.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Plays frames pulled from the engine through a render callback, which the
+// backend calls on its own audio thread
+class AudioBackend {
+public:
+  // Fills `out` with `num_frames` mono frames
+  using RenderCallback =
+    void (*)(void* context, sample_t* out, const u32 num_frames);
+
+  static constexpr u32 FRAMES_PER_CALLBACK = 2048;
+  static constexpr u16 NUM_CHANNELS = 2;
+
+  virtual ~AudioBackend() {}
+
+  // Returns false if the output could not be opened
+  virtual const bool start(const RenderCallback callback, void* context) = 0;
+
+  // Returns once the callback is no longer called
+  virtual void stop() = 0;
+
+  // Called periodically on the main thread. Returns false once the output has
+  // ended, e.g. because its device or pipe went away.
+  virtual const bool update() = 0;
+};
+
+// Backend for outputs that are written to: a thread renders one callback's
+// worth of frames and hands them to `write`, which may block until the output
+// has room for them. Derived destructors must call `stop`.
+class StreamBackend : public AudioBackend {
+public:
+  const bool start(const RenderCallback callback, void* context) override;
+  void stop() override;
+  const bool update() override { return running; }
+
+protected:
+  // Called on the starting thread
+  virtual const bool open() = 0;
+  // Called on the audio thread; returning false ends the stream
+  virtual const bool write(const sample_t* frames, const u32 num_frames) = 0;
+  // Called on the stopping thread, after the audio thread has finished
+  virtual void close() = 0;
+
+private:
+  void loop(const RenderCallback callback, void* context);
+
+  std::thread thread;
+  std::atomic<bool> running{false};
+  std::atomic<bool> stopping{false};
+};
+
+// Converts mono frames to interleaved 16 bit PCM on `num_channels` channels,
+// clamping them to [-1, 1]
+void interleave_pcm16(
+  const sample_t* frames,
+  const u32 num_frames,
+  const u16 num_channels,
+  i16* out);
+
+// Creates the backend called `name` (null, file, pipe, alsa or fmod), or the
+// best one built in if `name` is null. `path` is where the file and pipe
+// backends write, "-" meaning stdout. Returns null for unknown or unavailable
+// backends.
+std::unique_ptr<AudioBackend>
+create_audio_backend(const char* name, const char* path);
+
+#endif
@@ -0,0 +1,67 @@
+#ifdef IMP_WITH_ALSA
+#  include "alsa_backend.hpp"
+
+#  include <alsa/asoundlib.h>
+
+#  include <cstdio>
+
+const bool AlsaBackend::open()
+{
+  i32 result = snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0);
+  if (result < 0) {
+    fprintf(stderr, "ALSA error: %s\n", snd_strerror(result));
+    pcm = nullptr;
+    return false;
+  }
+
+  const u32 latency_us =
+    u32(2. * FRAMES_PER_CALLBACK * IMP_INV_SAMPLE_FREQ * 1000000.);
+  result = snd_pcm_set_params(
+    pcm,
+    SND_PCM_FORMAT_S16_LE,
+    SND_PCM_ACCESS_RW_INTERLEAVED,
+    NUM_CHANNELS,
+    u32(IMP_SAMPLE_FREQ),
+    1, // allow resampling
+    latency_us);
+  if (result < 0) {
+    fprintf(stderr, "ALSA error: %s\n", snd_strerror(result));
+    close();
+    return false;
+  }
+  return true;
+}
+
+const bool AlsaBackend::write(const sample_t* frames, const u32 num_frames)
+{
+  i16 pcm16[FRAMES_PER_CALLBACK * NUM_CHANNELS];
+  interleave_pcm16(frames, num_frames, NUM_CHANNELS, pcm16);
+
+  const i16* it = pcm16;
+  snd_pcm_uframes_t remaining = num_frames;
+  while (remaining != 0) {
+    snd_pcm_sframes_t written = snd_pcm_writei(pcm, it, remaining);
+    if (written < 0) {
+      // Recovers from underruns and suspends, which the device may report
+      written = snd_pcm_recover(pcm, i32(written), 1);
+      if (written < 0) {
+        return false;
+      }
+      continue;
+    }
+    it += written * NUM_CHANNELS;
+    remaining -= snd_pcm_uframes_t(written);
+  }
+  return true;
+}
+
+void AlsaBackend::close()
+{
+  if (pcm == nullptr) {
+    return;
+  }
+  snd_pcm_drain(pcm);
+  snd_pcm_close(pcm);
+  pcm = nullptr;
+}
+#endif
@@ -0,0 +1,23 @@
+#ifndef IMP_ALSA_BACKEND
+#define IMP_ALSA_BACKEND
+
+#include "engine/audio_backend.hpp"
+
+typedef struct _snd_pcm snd_pcm_t;
+
+// Plays through ALSA's default device with 16 bit stereo interleaved writes,
+// buffering two callbacks' worth of frames
+class AlsaBackend : public StreamBackend {
+public:
+  ~AlsaBackend() override { stop(); }
+
+protected:
+  const bool open() override;
+  const bool write(const sample_t* frames, const u32 num_frames) override;
+  void close() override;
+
+private:
+  snd_pcm_t* pcm = nullptr;
+};
+
+#endif
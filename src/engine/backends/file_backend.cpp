@@ -0,0 +1,12 @@
+#include "file_backend.hpp"
+
+const bool FileBackend::open()
+{
+  return writer.open(path, WavWriter::Format::Pcm16, NUM_CHANNELS);
+}
+
+const bool FileBackend::write(const sample_t* frames, const u32 num_frames)
+{
+  writer.write(frames, num_frames);
+  return true;
+}
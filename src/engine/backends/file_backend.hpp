@@ -0,0 +1,23 @@
+#ifndef IMP_FILE_BACKEND
+#define IMP_FILE_BACKEND
+
+#include "engine/audio_backend.hpp"
+#include "engine/wav_writer.hpp"
+
+// Writes 16 bit stereo WAV to `path` as fast as the engine renders
+class FileBackend : public StreamBackend {
+public:
+  explicit FileBackend(const char* path) : path(path) {}
+  ~FileBackend() override { stop(); }
+
+protected:
+  const bool open() override;
+  const bool write(const sample_t* frames, const u32 num_frames) override;
+  void close() override { writer.close(); }
+
+private:
+  const char* path;
+  WavWriter writer;
+};
+
+#endif
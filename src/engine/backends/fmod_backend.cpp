@@ -0,0 +1,151 @@
+#ifdef IMP_WITH_FMOD
+#  include "fmod_backend.hpp"
+
+#  include "math.hpp"
+
+#  include <fmod.hpp>
+#  include <fmod_errors.h>
+
+#  include <cstdio>
+#  include <cstring>
+
+#  define FMODERRCHECK(_result) FMODERRCHECK_fn(_result, __FILE__, __LINE__)
+static const bool
+FMODERRCHECK_fn(FMOD_RESULT result, const char* file, i32 line)
+{
+  if (result != FMOD_OK) {
+    fprintf(
+      stderr,
+      "%s(%d): FMOD error %d - %s\n",
+      file,
+      line,
+      result,
+      FMOD_ErrorString(result));
+    return false;
+  }
+  return true;
+}
+#  define FMODSOUNDERRCHECK(_result) \
+    FMODSOUNDERRCHECK_fn(_result, __FILE__, __LINE__)
+static const bool
+FMODSOUNDERRCHECK_fn(FMOD_RESULT result, const char* file, i32 line)
+{
+  if (result != FMOD_OK && result != FMOD_ERR_INVALID_HANDLE) {
+    return FMODERRCHECK_fn(result, file, line);
+  }
+  return true;
+}
+
+static FMOD_RESULT F_CALLBACK
+pcmreadcallback(FMOD_SOUND* sound, void* data, u32 datalen)
+{
+  FmodBackend* backend;
+  ((FMOD::Sound*)sound)->getUserData((void**)&backend);
+
+  // >>2 = 4 bytes per sample (16bit stereo)
+  backend->read(static_cast<i16*>(data), datalen >> 2);
+  return FMOD_OK;
+}
+
+static FMOD_RESULT F_CALLBACK pcmsetposcallback(
+  FMOD_SOUND* /*sound*/,
+  i32 /*subsound*/,
+  u32 /*position*/,
+  FMOD_TIMEUNIT /*postype*/)
+{
+  // This is useful if the user calls Channel::setPosition and you want to seek
+  // your data accordingly.
+  return FMOD_OK;
+}
+
+const bool FmodBackend::start(const RenderCallback callback, void* context)
+{
+  stop();
+  this->callback = callback;
+  this->context = context;
+
+  if (
+    !FMODERRCHECK(FMOD::System_Create(&system)) ||
+    !FMODERRCHECK(system->init(512, FMOD_INIT_NORMAL, nullptr))) {
+    stop();
+    return false;
+  }
+
+  // Create sound stream
+  FMOD_CREATESOUNDEXINFO exinfo;
+  FMOD_MODE mode = FMOD_OPENUSER | FMOD_LOOP_NORMAL | FMOD_CREATESTREAM;
+  memset(&exinfo, 0, sizeof(FMOD_CREATESOUNDEXINFO));
+  exinfo.cbsize = sizeof(FMOD_CREATESOUNDEXINFO); /* Required. */
+  exinfo.numchannels = NUM_CHANNELS; /* Number of channels in the sound. */
+  exinfo.defaultfrequency =
+    IMP_SAMPLE_FREQ; /* Default playback rate of sound. */
+  exinfo.decodebuffersize =
+    FRAMES_PER_CALLBACK; /* Chunk size of stream update in samples. This will
+                            be the amount of data passed to the user
+                            callback. */
+  exinfo.length = exinfo.defaultfrequency * exinfo.numchannels *
+    sizeof(i16); /* Length of PCM data in bytes of whole song (for
+                    Sound::getLength) */
+  exinfo.format = FMOD_SOUND_FORMAT_PCM16;  /* Data format of sound. */
+  exinfo.pcmreadcallback = pcmreadcallback; /* User callback for reading. */
+  exinfo.pcmsetposcallback =
+    pcmsetposcallback; /* User callback for seeking. */
+  exinfo.userdata = this;
+
+  if (
+    !FMODERRCHECK(system->createSound(nullptr, mode, &exinfo, &sound)) ||
+    !FMODERRCHECK(system->playSound(sound, nullptr, false, &channel))) {
+    stop();
+    return false;
+  }
+
+  // FMOD::DSP* dsp_echo;
+  // FMOD::DSP* dsp_lowpass;
+  // FMOD::ChannelGroup* channelgroup;
+
+  // // Add echo to the sound.
+  // FMODERRCHECK(system->createDSPByType(FMOD_DSP_TYPE_ECHO, &dsp_echo));
+  // FMODERRCHECK(channel->addDSP(1, dsp_echo));
+
+  // // Add the channel that the sound is playing on to a new channel group.
+  // FMODERRCHECK(system->createChannelGroup("my channelgroup", &channelgroup));
+  // FMODERRCHECK(channel->setChannelGroup(channelgroup));
+
+  // // Add a lowpass filter to that channel group.
+  // FMODERRCHECK(system->createDSPByType(FMOD_DSP_TYPE_LOWPASS, &dsp_lowpass));
+  // FMODERRCHECK(channelgroup->addDSP(1, dsp_lowpass));
+
+  return true;
+}
+
+void FmodBackend::stop()
+{
+  if (sound != nullptr) {
+    FMODERRCHECK(sound->release());
+    sound = nullptr;
+  }
+  if (system != nullptr) {
+    FMODERRCHECK(system->close());
+    FMODERRCHECK(system->release());
+    system = nullptr;
+  }
+  channel = nullptr;
+}
+
+const bool FmodBackend::update()
+{
+  bool is_playing = false;
+  FMODERRCHECK(system->update());
+  FMODSOUNDERRCHECK(channel->isPlaying(&is_playing));
+  return is_playing;
+}
+
+void FmodBackend::read(i16* out, const u32 num_frames)
+{
+  for (u32 offset = 0; offset < num_frames; offset += FRAMES_PER_CALLBACK) {
+    const u32 n = min(FRAMES_PER_CALLBACK, num_frames - offset);
+    callback(context, frames, n);
+    interleave_pcm16(frames, n, NUM_CHANNELS, out + offset * NUM_CHANNELS);
+  }
+}
+#endif
@@ -0,0 +1,38 @@
+#ifndef IMP_FMOD_BACKEND
+#define IMP_FMOD_BACKEND
+
+#include "engine/audio_backend.hpp"
+
+namespace FMOD {
+  class Channel;
+  class Sound;
+  class System;
+}
+
+// Plays a looping 16 bit stereo FMOD user stream, whose read callback pulls
+// from the render callback on FMOD's mixer thread
+class FmodBackend : public AudioBackend {
+public:
+  FmodBackend() {}
+  FmodBackend(const FmodBackend&) = delete;
+  FmodBackend& operator=(const FmodBackend&) = delete;
+  ~FmodBackend() override { stop(); }
+
+  const bool start(const RenderCallback callback, void* context) override;
+  void stop() override;
+  const bool update() override;
+
+  // Called by the stream to fill `num_frames` frames at `out`
+  void read(i16* out, const u32 num_frames);
+
+private:
+  RenderCallback callback = nullptr;
+  void* context = nullptr;
+  sample_t frames[FRAMES_PER_CALLBACK];
+
+  FMOD::System* system = nullptr;
+  FMOD::Channel* channel = nullptr;
+  FMOD::Sound* sound = nullptr;
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef IMP_NULL_BACKEND
+#define IMP_NULL_BACKEND
+
+#include "engine/audio_backend.hpp"
+
+// Discards everything, so the engine renders as fast as it can; for
+// benchmarks
+class NullBackend : public StreamBackend {
+public:
+  ~NullBackend() override { stop(); }
+
+protected:
+  const bool open() override { return true; }
+  const bool write(const sample_t*, const u32) override { return true; }
+  void close() override {}
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include "pipe_backend.hpp"
+
+#include <cstring>
+
+#ifdef _WIN32
+#  include <fcntl.h>
+#  include <io.h>
+#endif
+
+const bool PipeBackend::open()
+{
+  if (strcmp(path, "-") != 0) {
+    file = fopen(path, "wb");
+    return file != nullptr;
+  }
+
+#ifdef _WIN32
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  file = stdout;
+  return true;
+}
+
+const bool PipeBackend::write(const sample_t* frames, const u32 num_frames)
+{
+  // NOTE: assumes a little endian host
+  i16 pcm[FRAMES_PER_CALLBACK * NUM_CHANNELS];
+  interleave_pcm16(frames, num_frames, NUM_CHANNELS, pcm);
+  const size_t num_samples = size_t(num_frames) * NUM_CHANNELS;
+  return fwrite(pcm, sizeof(i16), num_samples, file) == num_samples;
+}
+
+void PipeBackend::close()
+{
+  if (file == nullptr) {
+    return;
+  }
+  if (file == stdout) {
+    fflush(file);
+  }
+  else {
+    fclose(file);
+  }
+  file = nullptr;
+}
@@ -0,0 +1,26 @@
+#ifndef IMP_PIPE_BACKEND
+#define IMP_PIPE_BACKEND
+
+#include "engine/audio_backend.hpp"
+
+#include <cstdio>
+
+// Streams headerless 16 bit little endian stereo at IMP_SAMPLE_FREQ to `path`,
+// or to stdout if it is "-", e.g. for `imp play --backend pipe | aplay -f cd`.
+// Writes block once the reader falls behind, which paces the engine.
+class PipeBackend : public StreamBackend {
+public:
+  explicit PipeBackend(const char* path) : path(path) {}
+  ~PipeBackend() override { stop(); }
+
+protected:
+  const bool open() override;
+  const bool write(const sample_t* frames, const u32 num_frames) override;
+  void close() override;
+
+private:
+  const char* path;
+  FILE* file = nullptr;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef IMP_COMMAND
+#define IMP_COMMAND
+
+#include "constants.hpp"
+
+struct Synth;
+
+// A message from a control thread (e.g. a game loop) to the renderer. It is
+// applied at the start of the first block beginning at or after `frame`.
+struct Command {
+  enum class Type : u8 {
+    Strike,       // note
+    Release,      // note
+    Slide,        // note, value (glide duration in seconds)
+    SetParameter, // parameter, value, and the LFO as note for LFO parameters
+    SwapSynth,    // synth
+    Morph,        // note, value (position in the synth's wavetable bank)
+  };
+
+  enum class Parameter : u8 {
+    Bpm,
+    TimeScale,
+    InstrumentActive, // of the instrument instance; 0 or 1
+    VibratoAmp,       // of the instrument instance's synth, and so on; LFO 0
+    VibratoFreq,
+    AttackDuration,
+    DecayDuration,
+    ReleaseDuration,
+    AttackAmplitude,
+    SustainAmplitude,
+    Gain, // ramps over VoiceBank::GAIN_SMOOTHING_DURATION
+    // Of the LFO at `note` of the synth, see set_lfo_parameter and LfoBank
+    LfoShape, // a LfoBank::Shape
+    LfoFrequency,
+    LfoPitchDepth,
+    LfoGainDepth,
+  };
+
+  // Absolute frame to apply at, see TimeState::get_frame
+  u64 frame;
+  Type type;
+  u8 instrument_instance_ix;
+  u8 note;
+  Parameter parameter;
+  union {
+    f64 value;
+    Synth* synth;
+  };
+
+  static Command strike(const u64 frame, const u8 instrument_ix, const u8 note)
+  {
+    Command command = {frame, Type::Strike, instrument_ix, note};
+    return command;
+  }
+
+  static Command release(const u64 frame, const u8 instrument_ix, const u8 note)
+  {
+    Command command = {frame, Type::Release, instrument_ix, note};
+    return command;
+  }
+
+  static Command slide(
+    const u64 frame,
+    const u8 instrument_ix,
+    const u8 note,
+    const f64 duration)
+  {
+    Command command = {frame, Type::Slide, instrument_ix, note};
+    command.value = duration;
+    return command;
+  }
+
+  static Command set_parameter(
+    const u64 frame,
+    const u8 instrument_ix,
+    const Parameter parameter,
+    const f64 value)
+  {
+    Command command = {frame, Type::SetParameter, instrument_ix, 0, parameter};
+    command.value = value;
+    return command;
+  }
+
+  static Command set_lfo_parameter(
+    const u64 frame,
+    const u8 instrument_ix,
+    const u8 lfo_ix,
+    const Parameter parameter,
+    const f64 value)
+  {
+    Command command = {
+      frame, Type::SetParameter, instrument_ix, lfo_ix, parameter};
+    command.value = value;
+    return command;
+  }
+
+  static Command morph(
+    const u64 frame,
+    const u8 instrument_ix,
+    const u8 note,
+    const f64 position)
+  {
+    Command command = {frame, Type::Morph, instrument_ix, note};
+    command.value = position;
+    return command;
+  }
+
+  static Command
+  swap_synth(const u64 frame, const u8 instrument_ix, Synth* synth)
+  {
+    Command command = {frame, Type::SwapSynth, instrument_ix};
+    command.synth = synth;
+    return command;
+  }
+};
+
+#endif
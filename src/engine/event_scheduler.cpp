@@ -0,0 +1,22 @@
+#include "event_scheduler.hpp"
+
+#include <algorithm>
+
+void EventScheduler::schedule(const u32 instrument_instance_ix, const u64 tick)
+{
+  heap[size++] = {tick, u8(instrument_instance_ix)};
+  std::push_heap(heap, heap + size, later);
+  scheduled[instrument_instance_ix] = true;
+}
+
+const u32 EventScheduler::pop_due(const u64 tick, u8* instrument_instance_ixs)
+{
+  u32 num_due = 0;
+  while (size != 0 && heap[0].tick <= tick) {
+    const u8 instrument_instance_ix = heap[0].instrument_instance_ix;
+    std::pop_heap(heap, heap + size--, later);
+    scheduled[instrument_instance_ix] = false;
+    instrument_instance_ixs[num_due++] = instrument_instance_ix;
+  }
+  return num_due;
+}
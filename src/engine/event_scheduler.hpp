@@ -0,0 +1,42 @@
+#ifndef IMP_EVENT_SCHEDULER
+#define IMP_EVENT_SCHEDULER
+
+#include "constants.hpp"
+
+// Min-heap of when each instrument instance's next event is due, in ticks
+// (see TimeState::get_tick). Finding the instances with events in a block then
+// costs O(log n) per due instance instead of a check per instance.
+class EventScheduler {
+public:
+  static constexpr u32 CAPACITY = IMP_NUM_INSTRUMENT_INSTANCES;
+
+  const bool is_scheduled(const u32 instrument_instance_ix) const
+  {
+    return scheduled[instrument_instance_ix];
+  }
+
+  // `instrument_instance_ix` must not be scheduled already
+  void schedule(const u32 instrument_instance_ix, const u64 tick);
+
+  // Unschedules every instance due at or before `tick`, writing their indices
+  // to `instrument_instance_ixs` and returning how many there are
+  const u32 pop_due(const u64 tick, u8* instrument_instance_ixs);
+
+private:
+  struct Entry {
+    u64 tick;
+    u8 instrument_instance_ix;
+  };
+
+  // std heaps are max-heaps
+  static const bool later(const Entry& a, const Entry& b)
+  {
+    return a.tick > b.tick;
+  }
+
+  Entry heap[CAPACITY];
+  u32 size = 0;
+  bool scheduled[CAPACITY] = {};
+};
+
+#endif
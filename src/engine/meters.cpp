@@ -0,0 +1,96 @@
+#include "meters.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void Meters::process(const sample_t* frames, const u32 num_frames)
+{
+  u64 block_num_clipped = 0;
+  for (u32 i = 0; i != num_frames; ++i) {
+    const f32 amplitude = f32(std::abs(frames[i]));
+    window_peak_so_far = std::max(window_peak_so_far, amplitude);
+    window_sum_squares += f64(frames[i]) * f64(frames[i]);
+    block_num_clipped += amplitude >= 1.f;
+
+    if (++window_num_frames == WINDOW_FRAMES) {
+      window_peak.store(window_peak_so_far, std::memory_order_relaxed);
+      window_rms.store(
+        f32(std::sqrt(window_sum_squares / WINDOW_FRAMES)),
+        std::memory_order_relaxed);
+      if (window_peak_so_far > peak.load(std::memory_order_relaxed)) {
+        peak.store(window_peak_so_far, std::memory_order_relaxed);
+      }
+      window_num_frames = 0;
+      window_sum_squares = .0;
+      window_peak_so_far = 0.f;
+    }
+  }
+
+  // Single writer, so no read-modify-write is needed
+  if (block_num_clipped != 0) {
+    this->num_clipped.store(
+      this->num_clipped.load(std::memory_order_relaxed) + block_num_clipped,
+      std::memory_order_relaxed);
+  }
+  this->num_frames.store(
+    this->num_frames.load(std::memory_order_relaxed) + num_frames,
+    std::memory_order_relaxed);
+}
+
+const Meters::Snapshot Meters::read() const
+{
+  Snapshot snapshot;
+  snapshot.num_frames = num_frames.load(std::memory_order_relaxed);
+  snapshot.num_clipped = num_clipped.load(std::memory_order_relaxed);
+  snapshot.peak = peak.load(std::memory_order_relaxed);
+  snapshot.window_peak = window_peak.load(std::memory_order_relaxed);
+  snapshot.window_rms = window_rms.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+MeterReporter::MeterReporter(
+  const Meters& meters,
+  FILE* file,
+  const std::chrono::milliseconds interval)
+  : meters(meters), file(file), interval(interval)
+{
+  thread = std::thread(&MeterReporter::loop, this);
+}
+
+MeterReporter::~MeterReporter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  thread.join();
+}
+
+void MeterReporter::loop()
+{
+  u64 num_clipped = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!wake.wait_for(lock, interval, [this]() { return stopping; })) {
+    const Meters::Snapshot snapshot = meters.read();
+    if (snapshot.num_clipped != num_clipped) {
+      num_clipped = snapshot.num_clipped;
+      print_meters(file, snapshot);
+    }
+  }
+}
+
+void print_meters(FILE* file, const Meters::Snapshot& snapshot)
+{
+  const auto dbfs = [](const f32 level) {
+    return level > 0.f ? 20. * std::log10(level) : -INFINITY;
+  };
+  fprintf(
+    file,
+    "clipped %llu samples, peak %.1f dBFS, window peak %.1f dBFS, "
+    "window rms %.1f dBFS\n",
+    (unsigned long long)snapshot.num_clipped,
+    dbfs(snapshot.peak),
+    dbfs(snapshot.window_peak),
+    dbfs(snapshot.window_rms));
+}
@@ -0,0 +1,76 @@
+#ifndef IMP_METERS
+#define IMP_METERS
+
+#include "constants.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// Level telemetry of the final mix. The audio thread is the only writer, so
+// every update is a plain relaxed store and never waits; any thread may read.
+//
+// Peak and RMS are published per window of WINDOW_FRAMES frames, so that
+// readers polling at any rate see the levels of whole windows.
+class Meters {
+public:
+  static constexpr u32 WINDOW_FRAMES = 4096;
+
+  struct Snapshot {
+    u64 num_frames;
+    u64 num_clipped; // samples at or beyond full scale
+    f32 peak;        // highest absolute sample so far
+    f32 window_peak;
+    f32 window_rms;
+  };
+
+  // Audio thread only
+  void process(const sample_t* frames, const u32 num_frames);
+
+  const Snapshot read() const;
+
+private:
+  // Audio thread only
+  u32 window_num_frames = 0;
+  f64 window_sum_squares = .0;
+  f32 window_peak_so_far = 0.f;
+
+  std::atomic<u64> num_frames{0};
+  std::atomic<u64> num_clipped{0};
+  std::atomic<f32> peak{0.f};
+  std::atomic<f32> window_peak{0.f};
+  std::atomic<f32> window_rms{0.f};
+};
+
+// Background thread printing a line to `file` whenever the mix clipped since
+// the last check, at most once per `interval`
+class MeterReporter {
+public:
+  MeterReporter(
+    const Meters& meters,
+    FILE* file,
+    const std::chrono::milliseconds interval = std::chrono::seconds(1));
+  MeterReporter(const MeterReporter&) = delete;
+  MeterReporter& operator=(const MeterReporter&) = delete;
+  ~MeterReporter();
+
+private:
+  void loop();
+
+  const Meters& meters;
+  FILE* file;
+  const std::chrono::milliseconds interval;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::thread thread;
+};
+
+// Prints `snapshot` to `file` as one line, with levels in dBFS
+void print_meters(FILE* file, const Meters::Snapshot& snapshot);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef IMP_PCM_RING
+#define IMP_PCM_RING
+
+#include "constants.hpp"
+#include "math.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+// Wait-free ring of mono frames for exactly one writer thread and one reader
+// thread. Unlike SpscQueue it moves frames in bulk and its capacity, rounded up
+// to a power of two, is chosen at runtime.
+class PcmRing {
+public:
+  explicit PcmRing(const u32 min_capacity)
+  {
+    while (capacity < min_capacity) {
+      capacity <<= 1;
+    }
+    frames = std::make_unique<sample_t[]>(capacity);
+  }
+
+  const u32 get_capacity() const { return capacity; }
+
+  // Either thread; exact for the calling side, a lower bound of what the
+  // reader can read or an upper bound of what the writer can write otherwise
+  const u32 size() const
+  {
+    return u32(
+      tail.load(std::memory_order_acquire) -
+      head.load(std::memory_order_acquire));
+  }
+
+  // Writer only. Returns how many of `num_frames` frames fit.
+  const u32 write(const sample_t* in, const u32 num_frames)
+  {
+    const u64 tail = this->tail.load(std::memory_order_relaxed);
+    const u64 head = this->head.load(std::memory_order_acquire);
+    const u32 n = min(num_frames, u32(capacity - (tail - head)));
+    const u32 start = u32(tail & (capacity - 1));
+    const u32 first = min(n, capacity - start);
+    std::copy(in, in + first, frames.get() + start);
+    std::copy(in + first, in + n, frames.get());
+    this->tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // Reader only. Returns how many of `num_frames` frames were available.
+  const u32 read(sample_t* out, const u32 num_frames)
+  {
+    const u64 head = this->head.load(std::memory_order_relaxed);
+    const u64 tail = this->tail.load(std::memory_order_acquire);
+    const u32 n = min(num_frames, u32(tail - head));
+    const u32 start = u32(head & (capacity - 1));
+    const u32 first = min(n, capacity - start);
+    std::copy(frames.get() + start, frames.get() + start + first, out);
+    std::copy(frames.get(), frames.get() + (n - first), out + first);
+    this->head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+private:
+  u32 capacity = 1;
+  std::unique_ptr<sample_t[]> frames;
+  alignas(64) std::atomic<u64> head{0};
+  alignas(64) std::atomic<u64> tail{0};
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+
+void Histogram::record(const u32 value)
+{
+  u32 bucket_ix = value;
+  if (value >= SUB_BUCKETS) {
+    u32 exponent = 4;
+    while (value >> (exponent + 1)) {
+      ++exponent;
+    }
+    const u32 shift = exponent - 4;
+    bucket_ix = (shift + 1) * SUB_BUCKETS + (value >> shift) - SUB_BUCKETS;
+  }
+  ++buckets[bucket_ix];
+  ++count;
+  max = std::max(max, value);
+}
+
+const u32 Histogram::percentile(const f64 fraction) const
+{
+  if (count == 0) {
+    return 0;
+  }
+
+  const u64 rank = std::max(u64(1), u64(fraction * count + .5));
+  u64 seen = 0;
+  u32 bucket_ix = 0;
+  while (seen + buckets[bucket_ix] < rank) {
+    seen += buckets[bucket_ix++];
+  }
+
+  if (bucket_ix < SUB_BUCKETS) {
+    return bucket_ix;
+  }
+  const u32 shift = bucket_ix / SUB_BUCKETS - 1;
+  const u64 mantissa = SUB_BUCKETS + bucket_ix % SUB_BUCKETS;
+  return u32(std::min(((mantissa + 1) << shift) - 1, u64(max)));
+}
+
+void Profiler::start()
+{
+  if (thread.joinable()) {
+    return;
+  }
+  stopping = false;
+  thread = std::thread(&Profiler::aggregator_loop, this);
+}
+
+void Profiler::stop()
+{
+  if (!thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  thread.join();
+}
+
+void Profiler::begin_callback(const u32 num_frames)
+{
+  profile.num_frames = num_frames;
+  profile.num_active_voices = 0;
+  std::fill(
+    profile.instrument_ns,
+    profile.instrument_ns + IMP_NUM_INSTRUMENT_INSTANCES,
+    0);
+  callback_start = Clock::now();
+}
+
+void Profiler::end_callback()
+{
+  profile.callback_ns = u32(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - callback_start)
+      .count());
+  if (!profiles.push(profile)) {
+    num_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Profiler::add_instrument_time(
+  const u32 instrument_instance_ix,
+  const Clock::duration duration)
+{
+  profile.instrument_ns[instrument_instance_ix] += u32(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+void Profiler::add_active_voices(const u32 num_active_voices)
+{
+  profile.num_active_voices =
+    std::max(profile.num_active_voices, num_active_voices);
+}
+
+void Profiler::dump(FILE* file)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  fprintf(
+    file,
+    "callbacks %llu (%llu dropped), deadline misses %llu\n",
+    (unsigned long long)callback_ns.get_count(),
+    (unsigned long long)num_dropped.load(std::memory_order_relaxed),
+    (unsigned long long)num_deadline_misses);
+  fprintf(file, "%-16s %10s %10s %10s\n", "", "p50", "p99", "max");
+
+  const auto print = [file](const char* name, const Histogram& histogram) {
+    fprintf(
+      file,
+      "%-16s %10u %10u %10u\n",
+      name,
+      histogram.percentile(.5),
+      histogram.percentile(.99),
+      histogram.get_max());
+  };
+  print("callback ns", callback_ns);
+  print("load %", load_percent);
+  print("active voices", num_active_voices);
+  for (u32 ix = 0; ix != IMP_NUM_INSTRUMENT_INSTANCES; ++ix) {
+    if (instrument_ns[ix].get_count() == 0) {
+      continue;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "instrument %u ns", ix);
+    print(name, instrument_ns[ix]);
+  }
+}
+
+void Profiler::aggregator_loop()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    while (const Profile* profile = profiles.peek()) {
+      aggregate(*profile);
+      profiles.pop();
+    }
+    if (stopping) {
+      return;
+    }
+    wake.wait_for(lock, std::chrono::milliseconds(1));
+  }
+}
+
+void Profiler::aggregate(const Profile& profile)
+{
+  const u64 deadline_ns = u64(profile.num_frames) * 1000000000ull /
+    u64(IMP_SAMPLE_FREQ);
+  const u64 load = deadline_ns ? u64(profile.callback_ns) * 100 / deadline_ns
+                               : 0;
+
+  callback_ns.record(profile.callback_ns);
+  load_percent.record(u32(std::min(load, u64(~0u))));
+  num_active_voices.record(profile.num_active_voices);
+  if (profile.callback_ns > deadline_ns) {
+    ++num_deadline_misses;
+  }
+
+  for (u32 ix = 0; ix != IMP_NUM_INSTRUMENT_INSTANCES; ++ix) {
+    if (profile.instrument_ns[ix] != 0) {
+      instrument_ns[ix].record(profile.instrument_ns[ix]);
+    }
+  }
+}
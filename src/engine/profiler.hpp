@@ -0,0 +1,105 @@
+#ifndef IMP_PROFILER
+#define IMP_PROFILER
+
+#include "constants.hpp"
+#include "spsc_queue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Log-linear histogram of u32 values: every power of two is split into
+// SUB_BUCKETS buckets, so percentiles are within 1/SUB_BUCKETS of the truth
+class Histogram {
+public:
+  static constexpr u32 SUB_BUCKETS = 16;
+  static constexpr u32 NUM_BUCKETS = (32 - 4 + 1) * SUB_BUCKETS;
+
+  void record(const u32 value);
+
+  // Returns the upper bound of the bucket holding the `fraction` quantile
+  const u32 percentile(const f64 fraction) const;
+
+  const u64 get_count() const { return count; }
+  const u32 get_max() const { return max; }
+
+private:
+  u64 buckets[NUM_BUCKETS] = {};
+  u64 count = 0;
+  u32 max = 0;
+};
+
+// Instrumentation of the audio callback that is safe to use on the audio
+// thread. Every callback fills in one Profile, which is pushed onto a wait-free
+// ring when the callback ends. A background thread drains the ring into
+// histograms that can be dumped at any time.
+//
+// If the aggregator falls behind, profiles are dropped and counted rather than
+// blocking the audio thread.
+class Profiler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t QUEUE_CAPACITY = 1024;
+
+  struct Profile {
+    u32 num_frames;
+    u32 callback_ns;
+    u32 num_active_voices; // most at the end of any block
+    u32 instrument_ns[IMP_NUM_INSTRUMENT_INSTANCES]; // 0 if not rendered
+  };
+
+  Profiler() {}
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+  ~Profiler() { stop(); }
+
+  // Starts / stops the aggregator thread
+  void start();
+  void stop();
+
+  // Audio thread only. A callback producing `num_frames` frames has a deadline
+  // of that many frames of real time.
+  void begin_callback(const u32 num_frames);
+  void end_callback();
+
+  // Render threads, between begin_callback and end_callback. Distinct threads
+  // must report distinct instrument instances.
+  void add_instrument_time(
+    const u32 instrument_instance_ix,
+    const Clock::duration duration);
+
+  // Audio thread, between begin_callback and end_callback
+  void add_active_voices(const u32 num_active_voices);
+
+  // Any thread
+  void dump(FILE* file);
+
+private:
+  void aggregator_loop();
+  void aggregate(const Profile& profile);
+
+  // Audio thread
+  Profile profile = {};
+  Clock::time_point callback_start;
+  SpscQueue<Profile, QUEUE_CAPACITY> profiles;
+  std::atomic<u64> num_dropped{0};
+
+  // Aggregator thread, guarded by `mutex`
+  std::mutex mutex;
+  Histogram callback_ns;
+  Histogram load_percent;
+  Histogram num_active_voices;
+  Histogram instrument_ns[IMP_NUM_INSTRUMENT_INSTANCES];
+  u64 num_deadline_misses = 0;
+
+  std::thread thread;
+  std::condition_variable wake;
+  bool stopping = false;
+};
+
+#endif
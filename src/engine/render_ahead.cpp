@@ -0,0 +1,56 @@
+#include "render_ahead.hpp"
+
+#include "math.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+RenderAhead::RenderAhead(
+  const AudioBackend::RenderCallback callback,
+  void* context,
+  const u32 latency_frames)
+  : callback(callback)
+  , context(context)
+  , latency_frames(max(latency_frames, CHUNK_FRAMES))
+  , ring(this->latency_frames)
+{
+  fill();
+  thread = std::thread(&RenderAhead::loop, this);
+}
+
+RenderAhead::~RenderAhead()
+{
+  stopping = true;
+  thread.join();
+}
+
+void RenderAhead::read(void* context, sample_t* out, const u32 num_frames)
+{
+  RenderAhead& render_ahead = *static_cast<RenderAhead*>(context);
+  const u32 n = render_ahead.ring.read(out, num_frames);
+  if (n != num_frames) {
+    std::fill(out + n, out + num_frames, sample_t(0));
+    render_ahead.num_underrun_frames.fetch_add(
+      num_frames - n, std::memory_order_relaxed);
+  }
+}
+
+void RenderAhead::fill()
+{
+  sample_t chunk[CHUNK_FRAMES];
+  while (ring.size() + CHUNK_FRAMES <= latency_frames) {
+    callback(context, chunk, CHUNK_FRAMES);
+    ring.write(chunk, CHUNK_FRAMES);
+  }
+}
+
+void RenderAhead::loop()
+{
+  // Polls rather than being woken, so the audio thread never makes a syscall
+  const auto poll_interval = std::chrono::duration<f64>(
+    .5 * CHUNK_FRAMES * IMP_INV_SAMPLE_FREQ);
+  while (!stopping) {
+    fill();
+    std::this_thread::sleep_for(poll_interval);
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef IMP_RENDER_AHEAD
+#define IMP_RENDER_AHEAD
+
+#include "audio_backend.hpp"
+#include "constants.hpp"
+#include "pcm_ring.hpp"
+
+#include <atomic>
+#include <thread>
+
+// Decouples rendering from the audio callback: a dedicated thread keeps up to
+// `latency_frames` frames rendered ahead in a PcmRing, and the callback only
+// copies them out. Rendering spikes shorter than the latency then no longer
+// glitch, at the cost of that much extra latency.
+class RenderAhead {
+public:
+  // Frames rendered per call of the wrapped callback
+  static constexpr u32 CHUNK_FRAMES = 4 * IMP_BLOCK_SIZE;
+
+  // Fills the ring before returning, so playback starts without underruns
+  RenderAhead(
+    const AudioBackend::RenderCallback callback,
+    void* context,
+    const u32 latency_frames);
+  RenderAhead(const RenderAhead&) = delete;
+  RenderAhead& operator=(const RenderAhead&) = delete;
+  ~RenderAhead();
+
+  // AudioBackend::RenderCallback to pass on, with the RenderAhead as
+  // `context`. Outputs silence for frames not rendered in time.
+  static void read(void* context, sample_t* out, const u32 num_frames);
+
+  const u64 get_num_underrun_frames() const
+  {
+    return num_underrun_frames.load(std::memory_order_relaxed);
+  }
+
+private:
+  void fill();
+  void loop();
+
+  const AudioBackend::RenderCallback callback;
+  void* context;
+  const u32 latency_frames;
+  PcmRing ring;
+
+  std::atomic<u64> num_underrun_frames{0};
+  std::atomic<bool> stopping{false};
+  std::thread thread;
+};
+
+#endif
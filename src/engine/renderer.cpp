@@ -0,0 +1,371 @@
+#include "renderer.hpp"
+
+#include "math.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+Renderer::Renderer(imp_song& song, const u32 num_threads)
+  : song(song), time_scale(song.time_state.get_time_scale())
+{
+  if (num_threads > 1) {
+    pool = std::make_unique<ThreadPool>(num_threads);
+  }
+}
+
+void Renderer::render(sample_t* out, const u32 num_frames)
+{
+  for (u32 offset = 0; offset < num_frames; offset += IMP_BLOCK_SIZE) {
+    render_block(out + offset, min(IMP_BLOCK_SIZE, num_frames - offset));
+  }
+}
+
+void Renderer::render_block(sample_t* out, const u32 num_frames)
+{
+  apply_commands();
+  if (tasks_changed) {
+    gather_tasks();
+    tasks_changed = false;
+  }
+  gather_due(num_frames);
+
+  if (pool) {
+    auto render = [this, num_frames](const u32 task_ix, const u32) {
+      render_task(task_ix, num_frames);
+    };
+    pool->parallel_for(num_tasks, render);
+  }
+  else {
+    for (u32 task_ix = 0; task_ix != num_tasks; ++task_ix) {
+      render_task(task_ix, num_frames);
+    }
+  }
+
+  // Mix
+  std::fill(out, out + num_frames, sample_t(0));
+  for (u32 task_ix = 0; task_ix != num_tasks; ++task_ix) {
+    const sample_t* frames = task_buffers[task_ix].frames;
+    for (u32 i = 0; i != num_frames; ++i) {
+      out[i] += frames[i];
+    }
+  }
+  meters.process(out, num_frames);
+
+  // Instances deactivated meanwhile are rescheduled when reactivated
+  for (u32 i = 0; i != num_due; ++i) {
+    const u8 ix = due_ixs[i];
+    is_due[ix] = false;
+    if (song.instrument_instances[ix].active) {
+      scheduler.schedule(ix, song.instrument_instances[ix].e_tick);
+    }
+  }
+
+  if (profiler) {
+    u32 num_active_voices = 0;
+    for (u32 task_ix = 0; task_ix != num_tasks; ++task_ix) {
+      num_active_voices += tasks[task_ix].synth->voices.get_num_active_voices();
+    }
+    profiler->add_active_voices(num_active_voices);
+  }
+
+  song.time_state.tick(num_frames);
+
+  // Time slows down to a stop after a while
+  constexpr f64 time_lerp_start_time = 100.;
+  constexpr f64 time_lerp_duration = 3.;
+  if (
+    !time_lerp_started &&
+    song.time_state.get_absolute_time() > time_lerp_start_time) {
+    time_scale.set(.0, time_lerp_duration, Interpolation::Cosine);
+    time_lerp_started = true;
+  }
+  if (time_scale.is_smoothing()) {
+    time_scale.skip(SAMPLE_DURATION, num_frames);
+    song.time_state.set_time_scale(time_scale.get());
+  }
+}
+
+void Renderer::apply_commands()
+{
+  const u64 frame = song.time_state.get_frame();
+  while (const Command* command = commands.peek()) {
+    if (command->frame > frame) {
+      return;
+    }
+    apply_command(*command);
+    commands.pop();
+  }
+}
+
+void Renderer::apply_command(const Command& command)
+{
+  if (command.instrument_instance_ix >= IMP_NUM_INSTRUMENT_INSTANCES) {
+    return;
+  }
+  imp_instrument_instance& instrument_instance =
+    song.instrument_instances[command.instrument_instance_ix];
+  Synth& synth = *instrument_instance.synth;
+  switch (command.type) {
+    case Command::Type::Strike:
+      synth.voices.strike(
+        command.note,
+        imp_note_freqs[command.note],
+        .0,
+        Interpolation::None);
+      return;
+    case Command::Type::Release:
+      synth.voices.release(command.note);
+      return;
+    case Command::Type::Slide:
+      synth.voices.strike(
+        command.note,
+        imp_note_freqs[command.note],
+        command.value,
+        Interpolation::Linear);
+      return;
+    case Command::Type::SwapSynth:
+      instrument_instance.synth = command.synth;
+      tasks_changed = true;
+      return;
+    case Command::Type::Morph:
+      synth.voices.set_morph(command.note, command.value);
+      return;
+    case Command::Type::SetParameter:
+      break;
+  }
+
+  const f64 value = command.value;
+  switch (command.parameter) {
+    case Command::Parameter::Bpm:
+      song.bpm = value;
+      return;
+    case Command::Parameter::TimeScale:
+      time_scale.set(value, .0, Interpolation::None);
+      song.time_state.set_time_scale(value);
+      return;
+    case Command::Parameter::InstrumentActive:
+      instrument_instance.active = value != .0;
+      tasks_changed = true;
+      return;
+    case Command::Parameter::Gain:
+      synth.voices.set_gain(value);
+      return;
+    case Command::Parameter::VibratoAmp:
+      synth.lfos.set_depth(0, LfoBank::Destination::Pitch, value);
+      return;
+    case Command::Parameter::VibratoFreq:
+      synth.lfos.set_frequency(0, value);
+      return;
+    case Command::Parameter::AttackDuration:
+      synth.adsr_params.attack_duration = value;
+      return;
+    case Command::Parameter::DecayDuration:
+      synth.adsr_params.decay_duration = value;
+      return;
+    case Command::Parameter::ReleaseDuration:
+      synth.adsr_params.release_duration = value;
+      return;
+    case Command::Parameter::AttackAmplitude:
+      synth.adsr_params.attack_amplitude = sample_t(value);
+      return;
+    case Command::Parameter::SustainAmplitude:
+      synth.adsr_params.sustain_amplitude = sample_t(value);
+      return;
+    case Command::Parameter::LfoShape:
+    case Command::Parameter::LfoFrequency:
+    case Command::Parameter::LfoPitchDepth:
+    case Command::Parameter::LfoGainDepth:
+      break;
+  }
+
+  // LFO parameters, of the LFO at `command.note`
+  if (command.note >= LfoBank::NUM_LFOS) {
+    return;
+  }
+  const u32 lfo_ix = command.note;
+  switch (command.parameter) {
+    case Command::Parameter::LfoShape:
+      if (value >= .0 && value <= f64(LfoBank::Shape::SampleAndHold)) {
+        synth.lfos.set_shape(lfo_ix, LfoBank::Shape(u8(value)));
+      }
+      return;
+    case Command::Parameter::LfoFrequency:
+      synth.lfos.set_frequency(lfo_ix, value);
+      return;
+    case Command::Parameter::LfoPitchDepth:
+      synth.lfos.set_depth(lfo_ix, LfoBank::Destination::Pitch, value);
+      return;
+    case Command::Parameter::LfoGainDepth:
+      synth.lfos.set_depth(lfo_ix, LfoBank::Destination::Gain, value);
+      return;
+    default:
+      return;
+  }
+}
+
+void Renderer::gather_tasks()
+{
+  num_tasks = 0;
+  for (size_t instrument_instance_ix = 0;
+       instrument_instance_ix < IMP_NUM_INSTRUMENT_INSTANCES;
+       ++instrument_instance_ix) {
+    // Get active instrument instance
+    imp_instrument_instance& instrument_instance =
+      song.instrument_instances[instrument_instance_ix];
+    if (!instrument_instance.active) {
+      continue;
+    }
+
+    // Events missed while inactive are skipped rather than caught up on
+    if (!scheduler.is_scheduled(instrument_instance_ix)) {
+      instrument_instance.e_tick =
+        max(instrument_instance.e_tick, song.time_state.get_tick());
+      scheduler.schedule(instrument_instance_ix, instrument_instance.e_tick);
+    }
+
+    // Instances sharing a synth share its voices, so they go in the same task
+    Task* task = std::find_if(
+      tasks, tasks + num_tasks, [&instrument_instance](const Task& task) {
+        return task.synth == instrument_instance.synth;
+      });
+    if (task == tasks + num_tasks) {
+      task->synth = instrument_instance.synth;
+      task->num_instrument_instances = 0;
+      ++num_tasks;
+    }
+    task->instrument_instance_ixs[task->num_instrument_instances++] =
+      u8(instrument_instance_ix);
+  }
+}
+
+void Renderer::gather_due(const u32 num_frames)
+{
+  TimeState block_end = song.time_state;
+  block_end.tick(num_frames);
+  num_due = scheduler.pop_due(block_end.get_tick(), due_ixs);
+  for (u32 i = 0; i != num_due; ++i) {
+    is_due[due_ixs[i]] = true;
+  }
+}
+
+void Renderer::render_task(const u32 task_ix, const u32 num_frames)
+{
+  const Task& task = tasks[task_ix];
+  sample_t* out = task_buffers[task_ix].frames;
+  std::fill(out, out + num_frames, sample_t(0));
+
+  for (u32 i = 0; i != task.num_instrument_instances; ++i) {
+    const u8 instrument_instance_ix = task.instrument_instance_ixs[i];
+    imp_instrument_instance& instrument_instance =
+      song.instrument_instances[instrument_instance_ix];
+    const bool is_due = this->is_due[instrument_instance_ix];
+    if (!profiler) {
+      render_instrument(instrument_instance, is_due, out, num_frames);
+      continue;
+    }
+
+    const Profiler::Clock::time_point start = Profiler::Clock::now();
+    render_instrument(instrument_instance, is_due, out, num_frames);
+    profiler->add_instrument_time(
+      instrument_instance_ix, Profiler::Clock::now() - start);
+  }
+}
+
+void Renderer::render_instrument(
+  imp_instrument_instance& instrument_instance,
+  const bool is_due,
+  sample_t* out,
+  const u32 num_frames)
+{
+  Synth& synth = *instrument_instance.synth;
+  TimeState time_state = song.time_state;
+  const f64 dt = time_state.get_scaled_delta_time();
+
+  u32 offset = 0;
+  while (offset != num_frames) {
+    const bool has_events =
+      is_due && handle_events(instrument_instance, time_state);
+
+    // Render up until the frame at which the next event is due, or to the end
+    // of the block while waiting for the composer
+    const u32 remaining = num_frames - offset;
+    const u32 span = has_events
+      ? u32(min(
+          u64(remaining),
+          time_state.get_frames_until(instrument_instance.e_tick)))
+      : remaining;
+
+    // Sum voice amplitudes
+    synth.voices.render(synth, time_state, out + offset, span);
+
+    time_state.tick(span);
+
+    synth.lfos.advance(dt, span);
+
+    offset += span;
+  }
+}
+
+const bool Renderer::handle_events(
+  imp_instrument_instance& instrument_instance,
+  const TimeState& time_state)
+{
+  Synth& synth = *instrument_instance.synth;
+  auto& events = instrument_instance.queue;
+  f64 num_beats_consumed =
+    instrument_instance.num_beats_consumed.load(std::memory_order_relaxed);
+
+  while (instrument_instance.e_tick <= time_state.get_tick()) {
+    // The composer fell behind; never generate here. Late events play once
+    // they arrive.
+    if (events.get_state() == CircularRWBufferBase::State::Empty) {
+      instrument_instance.e_tick = time_state.get_tick();
+      return false;
+    }
+
+    u8 event = events.read();
+
+    if (event == IMP_EVENT_TYPE_STRIKE) {
+      u8 note = events.read();
+      u8 wait = events.read();
+      u8 div = events.read();
+      f64 duration = 60. * (wait * 4. / div) / song.bpm;
+
+      synth.voices.strike(
+        note, imp_note_freqs[note], duration, Interpolation::None);
+
+      instrument_instance.e_tick += TimeState::to_ticks(duration);
+      num_beats_consumed += wait * 4. / div;
+    }
+    else if (event == IMP_EVENT_TYPE_SLIDE) {
+      u8 note = events.read();
+      u8 wait = events.read();
+      u8 div = events.read();
+      f64 duration = 60. * (wait * 4. / div) / song.bpm;
+
+      synth.voices.strike(
+        note,
+        imp_note_freqs[note],
+        duration / 4.,
+        Interpolation::Linear);
+
+      instrument_instance.e_tick += TimeState::to_ticks(duration);
+      num_beats_consumed += wait * 4. / div;
+    }
+    else if (event == IMP_EVENT_TYPE_RELEASE) {
+      synth.voices.release(events.read());
+    }
+    else if (event == IMP_EVENT_TYPE_WAIT) {
+      u8 wait = events.read();
+      u8 div = events.read();
+      f64 beats_wait = wait * 4. / div;
+      instrument_instance.e_tick +=
+        TimeState::to_ticks(60. * beats_wait / song.bpm);
+      num_beats_consumed += beats_wait;
+    }
+
+    instrument_instance.num_beats_consumed.store(
+      num_beats_consumed, std::memory_order_relaxed);
+  }
+  return true;
+}
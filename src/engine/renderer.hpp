@@ -0,0 +1,111 @@
+#ifndef IMP_RENDERER
+#define IMP_RENDERER
+
+#include "command.hpp"
+#include "composition/song.hpp"
+#include "constants.hpp"
+#include "event_scheduler.hpp"
+#include "math.hpp"
+#include "meters.hpp"
+#include "profiler.hpp"
+#include "spsc_queue.hpp"
+#include "thread_pool.hpp"
+#include "time_state.hpp"
+
+#include <memory>
+
+// Renders a song block by block. Within a block, each instrument instance is
+// split into spans at its event boundaries, and every voice is then run over
+// each span in one go.
+//
+// Instrument instances sharing a synth form one task. Tasks render into their
+// own buffers, which are then summed in task order, so the mix does not depend
+// on how many threads render it.
+//
+// Only instances with events due in a block, as found by the EventScheduler,
+// handle events; the others render the whole block in one span.
+//
+// Other threads control the song through `post`, whose commands are applied at
+// block starts.
+class Renderer {
+public:
+  static constexpr size_t COMMAND_QUEUE_CAPACITY = 1024;
+
+  // Renders tasks on `num_threads` threads, including the calling one
+  Renderer(imp_song& song, const u32 num_threads = 1);
+
+  // Writes `num_frames` mono frames to `out`
+  void render(sample_t* out, const u32 num_frames);
+
+  // Wait-free; must only be called from one thread at a time. Commands must
+  // be posted in order of `Command::frame`. Returns false if the queue is
+  // full.
+  const bool post(const Command& command) { return commands.push(command); }
+
+  // Reports instrument render times and active voices to `profiler`, if not
+  // null. Callers time their callbacks themselves.
+  void set_profiler(Profiler* profiler) { this->profiler = profiler; }
+  Profiler* get_profiler() const { return profiler; }
+
+  // Levels of everything rendered so far, before any clamping
+  const Meters& get_meters() const { return meters; }
+
+private:
+  struct Task {
+    Synth* synth;
+    u32 num_instrument_instances;
+    u8 instrument_instance_ixs[IMP_NUM_INSTRUMENT_INSTANCES];
+  };
+
+  struct alignas(64) TaskBuffer {
+    sample_t frames[IMP_BLOCK_SIZE];
+  };
+
+  void render_block(sample_t* out, const u32 num_frames);
+
+  void apply_commands();
+
+  void apply_command(const Command& command);
+
+  void gather_tasks();
+
+  // Pops the instances with events due within the next `num_frames` frames
+  void gather_due(const u32 num_frames);
+
+  void render_task(const u32 task_ix, const u32 num_frames);
+
+  void render_instrument(
+    imp_instrument_instance& instrument_instance,
+    const bool is_due,
+    sample_t* out,
+    const u32 num_frames);
+
+  // Returns false if the event queue ran dry before the next event was due
+  const bool handle_events(
+    imp_instrument_instance& instrument_instance,
+    const TimeState& time_state);
+
+  imp_song& song;
+  std::unique_ptr<ThreadPool> pool;
+  SpscQueue<Command, COMMAND_QUEUE_CAPACITY> commands;
+  Profiler* profiler = nullptr;
+  Meters meters;
+
+  // Applied to the song's time state block by block, as it only changes at
+  // block boundaries
+  Smoothed time_scale;
+  bool time_lerp_started = false;
+
+  // Tasks only change with commands activating instances or swapping synths
+  bool tasks_changed = true;
+  u32 num_tasks = 0;
+  Task tasks[IMP_NUM_INSTRUMENT_INSTANCES];
+
+  EventScheduler scheduler;
+  u32 num_due = 0;
+  u8 due_ixs[IMP_NUM_INSTRUMENT_INSTANCES];
+  bool is_due[IMP_NUM_INSTRUMENT_INSTANCES] = {};
+  TaskBuffer task_buffers[IMP_NUM_INSTRUMENT_INSTANCES];
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef IMP_SPSC_QUEUE
+#define IMP_SPSC_QUEUE
+
+#include "constants.hpp"
+
+#include <atomic>
+
+// Wait-free ring buffer for exactly one producer thread and one consumer
+// thread. Unlike CircularRWBuffer it never throws: `push` reports a full
+// queue instead, so that neither side can stall or unwind on the audio thread.
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+public:
+  static_assert(
+    CAPACITY != 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+    "CAPACITY must be a power of two");
+
+  // Producer only. Returns false if the queue is full.
+  const bool push(const T& item)
+  {
+    const size_t tail = this->tail.load(std::memory_order_relaxed);
+    if (tail - head.load(std::memory_order_acquire) == CAPACITY) {
+      return false;
+    }
+    items[tail & (CAPACITY - 1)] = item;
+    this->tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Returns the oldest item without removing it, or nullptr if
+  // the queue is empty.
+  const T* peek() const
+  {
+    const size_t head = this->head.load(std::memory_order_relaxed);
+    if (head == tail.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &items[head & (CAPACITY - 1)];
+  }
+
+  // Consumer only. Removes the item returned by `peek`.
+  void pop()
+  {
+    head.store(
+      head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+private:
+  // NOTE: separate cache lines, so producer and consumer don't false share
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+  alignas(64) T items[CAPACITY];
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "thread_pool.hpp"
+
+namespace {
+  constexpr u32 SPIN_LIMIT = 1 << 12;
+
+  constexpr u64 pack(const u32 begin, const u32 end)
+  {
+    return u64(begin) | (u64(end) << 32);
+  }
+
+  constexpr u32 range_begin(const u64 range) { return u32(range); }
+
+  constexpr u32 range_end(const u64 range) { return u32(range >> 32); }
+}
+
+ThreadPool::ThreadPool(const u32 num_workers)
+  : num_workers(num_workers > 0 ? num_workers : 1),
+    queues(new Queue[this->num_workers])
+{
+  threads.reserve(this->num_workers - 1);
+  for (u32 worker_ix = 1; worker_ix < this->num_workers; ++worker_ix) {
+    threads.emplace_back([this, worker_ix]() { worker_loop(worker_ix); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::run(const u32 num_tasks, const JobFn fn, void* context)
+{
+  if (num_tasks == 0) {
+    return;
+  }
+
+  job_fn = fn;
+  job_context = context;
+  num_remaining.store(num_tasks, std::memory_order_relaxed);
+
+  // Publish an even split; the release stores make the job visible to every
+  // worker that claims a task from them
+  for (u32 worker_ix = 0; worker_ix != num_workers; ++worker_ix) {
+    const u32 begin = u32(u64(num_tasks) * worker_ix / num_workers);
+    const u32 end = u32(u64(num_tasks) * (worker_ix + 1) / num_workers);
+    queues[worker_ix].range.store(pack(begin, end), std::memory_order_release);
+  }
+
+  // NOTE: both this and the workers' sleep check are sequentially consistent,
+  // so either we see a sleeper or it sees the new generation
+  ++generation;
+  if (num_sleeping != 0) {
+    std::lock_guard<std::mutex> lock(mutex);
+    wake.notify_all();
+  }
+
+  while (run_one(0)) {
+  }
+
+  // Wait for tasks stolen by others to finish
+  while (num_remaining.load(std::memory_order_acquire) != 0) {
+    std::this_thread::yield();
+  }
+}
+
+void ThreadPool::worker_loop(const u32 worker_ix)
+{
+  u64 seen_generation = 0;
+  for (;;) {
+    for (u32 spins = 0; spins != SPIN_LIMIT; ++spins) {
+      if (stopping || generation != seen_generation) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+
+    if (!stopping && generation == seen_generation) {
+      std::unique_lock<std::mutex> lock(mutex);
+      ++num_sleeping;
+      wake.wait(
+        lock, [&]() { return stopping || generation != seen_generation; });
+      --num_sleeping;
+    }
+
+    if (stopping) {
+      return;
+    }
+    seen_generation = generation;
+
+    while (run_one(worker_ix)) {
+    }
+  }
+}
+
+const bool ThreadPool::run_one(const u32 worker_ix)
+{
+  u32 task_ix;
+  bool found = pop(queues[worker_ix], task_ix);
+  for (u32 i = 1; !found && i != num_workers; ++i) {
+    found = steal(queues[(worker_ix + i) % num_workers], task_ix);
+  }
+  if (!found) {
+    return false;
+  }
+
+  job_fn(job_context, task_ix, worker_ix);
+  num_remaining.fetch_sub(1, std::memory_order_acq_rel);
+  return true;
+}
+
+const bool ThreadPool::pop(Queue& queue, u32& task_ix)
+{
+  u64 range = queue.range.load(std::memory_order_acquire);
+  while (range_begin(range) < range_end(range)) {
+    const u64 popped = pack(range_begin(range) + 1, range_end(range));
+    if (queue.range.compare_exchange_weak(
+          range, popped, std::memory_order_acq_rel)) {
+      task_ix = range_begin(range);
+      return true;
+    }
+  }
+  return false;
+}
+
+const bool ThreadPool::steal(Queue& queue, u32& task_ix)
+{
+  u64 range = queue.range.load(std::memory_order_acquire);
+  while (range_begin(range) < range_end(range)) {
+    const u64 stolen = pack(range_begin(range), range_end(range) - 1);
+    if (queue.range.compare_exchange_weak(
+          range, stolen, std::memory_order_acq_rel)) {
+      task_ix = range_end(range) - 1;
+      return true;
+    }
+  }
+  return false;
+}
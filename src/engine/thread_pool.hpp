@@ -0,0 +1,74 @@
+#ifndef IMP_THREAD_POOL
+#define IMP_THREAD_POOL
+
+#include "constants.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running parallel-for jobs. Every job is split
+// into one contiguous range of task indices per worker; a worker pops from the
+// front of its own range and, once that is exhausted, steals from the back of
+// the others. Ranges are packed into a single atomic so popping and stealing
+// are lock-free. The calling thread takes part as worker 0.
+class ThreadPool {
+public:
+  // Spawns `num_workers - 1` threads
+  explicit ThreadPool(const u32 num_workers);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  const u32 get_num_workers() const { return num_workers; }
+
+  // Calls `fn(task_ix, worker_ix)` for every `task_ix` in [0, num_tasks) and
+  // returns once all calls have returned
+  template <typename F>
+  void parallel_for(const u32 num_tasks, F& fn);
+
+private:
+  using JobFn = void (*)(void* context, const u32 task_ix, const u32 worker_ix);
+
+  struct alignas(64) Queue {
+    std::atomic<u64> range{0}; // begin in the low, end in the high 32 bits
+  };
+
+  void run(const u32 num_tasks, const JobFn fn, void* context);
+  void worker_loop(const u32 worker_ix);
+  const bool run_one(const u32 worker_ix);
+  const bool pop(Queue& queue, u32& task_ix);
+  const bool steal(Queue& queue, u32& task_ix);
+
+  const u32 num_workers;
+  std::unique_ptr<Queue[]> queues;
+  std::vector<std::thread> threads;
+
+  JobFn job_fn = nullptr;
+  void* job_context = nullptr;
+  std::atomic<u32> num_remaining{0};
+
+  // Workers spin on `generation` for a while before sleeping on `wake`, as
+  // jobs tend to come in quick succession
+  std::atomic<u64> generation{0};
+  std::atomic<u32> num_sleeping{0};
+  std::atomic<bool> stopping{false};
+  std::mutex mutex;
+  std::condition_variable wake;
+};
+
+template <typename F>
+void ThreadPool::parallel_for(const u32 num_tasks, F& fn)
+{
+  run(
+    num_tasks,
+    [](void* context, const u32 task_ix, const u32 worker_ix) {
+      (*static_cast<F*>(context))(task_ix, worker_ix);
+    },
+    &fn);
+}
+
+#endif
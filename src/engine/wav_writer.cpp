@@ -0,0 +1,119 @@
+#include "wav_writer.hpp"
+
+#include "math.hpp"
+
+namespace {
+  // RIFF is little endian regardless of host
+  void write_u16(FILE* file, const u16 value)
+  {
+    const u8 bytes[] = {u8(value), u8(value >> 8)};
+    fwrite(bytes, 1, sizeof(bytes), file);
+  }
+
+  void write_u32(FILE* file, const u32 value)
+  {
+    const u8 bytes[] = {
+      u8(value), u8(value >> 8), u8(value >> 16), u8(value >> 24)};
+    fwrite(bytes, 1, sizeof(bytes), file);
+  }
+}
+
+bool WavWriter::open(
+  const char* path,
+  const Format format,
+  const u16 num_channels)
+{
+  close();
+
+  if (num_channels == 0 || num_channels > MAX_NUM_CHANNELS) {
+    return false;
+  }
+
+  file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  this->format = format;
+  this->num_channels = num_channels;
+  num_data_bytes = 0;
+
+  if (format != Format::RawFloat32) {
+    write_header();
+  }
+  return true;
+}
+
+void WavWriter::write(const sample_t* frames, const u32 num_frames)
+{
+  constexpr u32 CHUNK_FRAMES = 256;
+
+  if (format == Format::Pcm16) {
+    i16 chunk[CHUNK_FRAMES * MAX_NUM_CHANNELS];
+    for (u32 offset = 0; offset < num_frames; offset += CHUNK_FRAMES) {
+      const u32 n = min(CHUNK_FRAMES, num_frames - offset);
+      i16* it = chunk;
+      for (u32 i = 0; i != n; ++i) {
+        const i16 val = i16(clamp(-1., 1., f64(frames[offset + i])) * 32767.);
+        for (u16 c = 0; c != num_channels; ++c) {
+          *it++ = val;
+        }
+      }
+      num_data_bytes +=
+        u32(fwrite(chunk, sizeof(i16), it - chunk, file) * sizeof(i16));
+    }
+    return;
+  }
+
+  f32 chunk[CHUNK_FRAMES * MAX_NUM_CHANNELS];
+  for (u32 offset = 0; offset < num_frames; offset += CHUNK_FRAMES) {
+    const u32 n = min(CHUNK_FRAMES, num_frames - offset);
+    f32* it = chunk;
+    for (u32 i = 0; i != n; ++i) {
+      const f32 val = f32(frames[offset + i]);
+      for (u16 c = 0; c != num_channels; ++c) {
+        *it++ = val;
+      }
+    }
+    num_data_bytes +=
+      u32(fwrite(chunk, sizeof(f32), it - chunk, file) * sizeof(f32));
+  }
+}
+
+void WavWriter::close()
+{
+  if (file == nullptr) {
+    return;
+  }
+
+  if (format != Format::RawFloat32) {
+    fseek(file, 0, SEEK_SET);
+    write_header();
+  }
+
+  fclose(file);
+  file = nullptr;
+}
+
+void WavWriter::write_header()
+{
+  const bool is_float = format == Format::Float32;
+  const u16 bytes_per_sample = is_float ? sizeof(f32) : sizeof(i16);
+  const u32 sample_rate = u32(IMP_SAMPLE_FREQ);
+
+  fwrite("RIFF", 1, 4, file);
+  write_u32(file, 36 + num_data_bytes);
+  fwrite("WAVE", 1, 4, file);
+
+  fwrite("fmt ", 1, 4, file);
+  write_u32(file, 16);
+  write_u16(file, is_float ? 3 : 1); // WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM
+  write_u16(file, num_channels);
+  write_u32(file, sample_rate);
+  write_u32(file, sample_rate * num_channels * bytes_per_sample);
+  write_u16(file, num_channels * bytes_per_sample);
+  write_u16(file, bytes_per_sample * 8);
+
+  fwrite("data", 1, 4, file);
+  write_u32(file, num_data_bytes);
+}
@@ -0,0 +1,38 @@
+#ifndef IMP_WAV_WRITER
+#define IMP_WAV_WRITER
+
+#include "constants.hpp"
+
+#include <cstdio>
+
+// Streams rendered frames to disk, either as a RIFF/WAVE file or as headerless
+// interleaved f32. WAV sizes are patched in on close, so nothing is buffered.
+class WavWriter {
+public:
+  enum class Format { Pcm16, Float32, RawFloat32 };
+
+  static constexpr u16 MAX_NUM_CHANNELS = 8;
+
+  WavWriter() {}
+  WavWriter(const WavWriter&) = delete;
+  WavWriter& operator=(const WavWriter&) = delete;
+  ~WavWriter() { close(); }
+
+  bool open(const char* path, const Format format, const u16 num_channels);
+
+  // Writes `num_frames` mono frames, duplicated onto every channel. Samples are
+  // clamped to [-1, 1] for Pcm16.
+  void write(const sample_t* frames, const u32 num_frames);
+
+  void close();
+
+private:
+  void write_header();
+
+  FILE* file = nullptr;
+  Format format = Format::Pcm16;
+  u16 num_channels = 2;
+  u32 num_data_bytes = 0;
+};
+
+#endif
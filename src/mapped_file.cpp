@@ -0,0 +1,88 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::unique_ptr<MappedFile> MappedFile::open(const char* path)
+{
+  const HANDLE file = CreateFileA(
+    path,
+    GENERIC_READ,
+    FILE_SHARE_READ,
+    nullptr,
+    OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL,
+    nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+
+  // The mapping keeps the file open
+  LARGE_INTEGER size;
+  HANDLE mapping = nullptr;
+  if (GetFileSizeEx(file, &size) && size.QuadPart != 0) {
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  }
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return nullptr;
+  }
+
+  const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedFile> mapped_file(new MappedFile());
+  mapped_file->data = static_cast<const u8*>(data);
+  mapped_file->size = size_t(size.QuadPart);
+  mapped_file->mapping = mapping;
+  return mapped_file;
+}
+
+MappedFile::~MappedFile()
+{
+  UnmapViewOfFile(data);
+  CloseHandle(mapping);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::open(const char* path)
+{
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  // The mapping keeps the file open
+  struct stat status;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &status) == 0 && status.st_size != 0) {
+    data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedFile> mapped_file(new MappedFile());
+  mapped_file->data = static_cast<const u8*>(data);
+  mapped_file->size = size_t(status.st_size);
+  return mapped_file;
+}
+
+MappedFile::~MappedFile() { munmap(const_cast<u8*>(data), size); }
+
+#endif
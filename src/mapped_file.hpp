@@ -0,0 +1,33 @@
+#ifndef IMP_MAPPED_FILE
+#define IMP_MAPPED_FILE
+
+#include "constants.hpp"
+
+#include <memory>
+
+// Read-only memory mapping of a whole file. Pages are loaded on first access
+// and shared with every other process mapping the same file.
+class MappedFile {
+public:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  // Returns null if `path` could not be mapped, e.g. because it is empty
+  static std::unique_ptr<MappedFile> open(const char* path);
+
+  // Page aligned
+  const u8* get_data() const { return data; }
+  const size_t get_size() const { return size; }
+
+private:
+  MappedFile() {}
+
+  const u8* data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  void* mapping = nullptr;
+#endif
+};
+
+#endif
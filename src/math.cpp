@@ -1,6 +1,16 @@
 #include "math.hpp"
 #include "time_state.hpp"
 
+#include <algorithm>
+
+const SegmentTable
+  COSINE_SEGMENT_TABLE([](const f64 x) { return .5 - cos(PI * x) * .5; });
+
+const SegmentTable EXPONENTIAL_SEGMENT_TABLE([](const f64 x) {
+  constexpr f64 k = ExponentialInterpolation::RATE;
+  return (1. - exp(-k * x)) / (1. - exp(-k));
+});
+
 Interpolated::Interpolated()
 {
 }
@@ -24,16 +34,63 @@ void Interpolated::set(
 
 const f64 Interpolated::get(const TimeState& time_state) const noexcept
 {
-  return interpolate(
-    prev_value,
-    target_value,
-    interpolation_duration < DBL_EPSILON
-      ? 1.
-      : (time_state.get_scaled_time() - start_time) / interpolation_duration,
-    interpolation);
+  const f64 t = interpolation_duration < DBL_EPSILON
+    ? 1.
+    : (time_state.get_scaled_time() - start_time) / interpolation_duration;
+  return dispatch_interpolation(interpolation, [&](const auto policy) {
+    using Policy = decltype(policy);
+    return interpolate<Policy>(prev_value, target_value, min(t, 1.));
+  });
 }
 
 const f64 Interpolated::get_target_value() const noexcept
 {
   return target_value;
 }
+
+void Smoothed::set(
+  const f64 target,
+  const f64 duration,
+  const Interpolation interpolation) noexcept
+{
+  from = get();
+  this->target = target;
+  this->duration = duration;
+  this->interpolation = interpolation;
+  const bool jumps =
+    interpolation == Interpolation::None || duration < DBL_EPSILON;
+  position = jumps ? 1. : .0;
+}
+
+const f64 Smoothed::get() const noexcept
+{
+  if (position >= 1.) {
+    return target;
+  }
+  return dispatch_interpolation(interpolation, [&](const auto policy) {
+    return from + (target - from) * decltype(policy)::shape(position);
+  });
+}
+
+void Smoothed::render(const f64 dt, f64* out, const u32 num_frames) noexcept
+{
+  u32 i = 0;
+  if (position < 1.) {
+    const f64 increment = dt / duration;
+    const f64 delta = target - from;
+    dispatch_interpolation(interpolation, [&](const auto policy) {
+      for (; i != num_frames && position < 1.; ++i) {
+        out[i] = from + delta * decltype(policy)::shape(position);
+        position += increment;
+      }
+    });
+  }
+  std::fill(out + i, out + num_frames, target);
+}
+
+void Smoothed::skip(const f64 dt, const u32 num_frames) noexcept
+{
+  if (position < 1.) {
+    position = min(1., position + num_frames * dt / duration);
+  }
+}
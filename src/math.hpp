@@ -53,24 +53,105 @@ enum class Interpolation {
   None,
   Linear,
   Cosine,
+  Exponential,
+  SCurve,
 };
 
-inline const f64 interpolate(
-  const f64 a,
-  const f64 b,
-  const f64 t,
-  const Interpolation interpolation) noexcept
+// Table of a segment shape over x in [0, 1], looked up with linear
+// interpolation for shapes too costly to evaluate per sample
+struct SegmentTable {
+  static constexpr u32 SIZE = 1024;
+
+  template <typename Shape>
+  explicit SegmentTable(const Shape& shape)
+  {
+    for (u32 i = 0; i <= SIZE; ++i) {
+      values[i] = shape(f64(i) / SIZE);
+    }
+  }
+
+  const f64 operator()(const f64 x) const noexcept
+  {
+    const f64 ixf = x * SIZE;
+    const u32 ix = u32(ixf);
+    return lerp(values[ix], values[ix + 1], ixf - ix);
+  }
+
+  f64 values[SIZE + 1]; // the last entry spares a wrap check
+};
+
+// .5 - .5 cos(pi x), the shape `cerp` interpolates by
+extern const SegmentTable COSINE_SEGMENT_TABLE;
+// 1 - e^(-k x), scaled to reach 1 at x = 1
+extern const SegmentTable EXPONENTIAL_SEGMENT_TABLE;
+
+inline const f64 cosine_segment(const f64 x) noexcept
+{
+  return COSINE_SEGMENT_TABLE(x);
+}
+
+// Interpolation policies. `shape` maps progress x in [0, 1] to how far to go
+// from the start value towards the target, 0 at x = 0 and 1 at x = 1 (except
+// for the step). Callers pick a policy once per ramp with
+// `dispatch_interpolation`, so that the shape inlines into their loops.
+struct StepInterpolation {
+  static constexpr Interpolation TYPE = Interpolation::None;
+  static const f64 shape(const f64) noexcept { return 1.; }
+};
+
+struct LinearInterpolation {
+  static constexpr Interpolation TYPE = Interpolation::Linear;
+  static const f64 shape(const f64 x) noexcept { return x; }
+};
+
+struct CosineInterpolation {
+  static constexpr Interpolation TYPE = Interpolation::Cosine;
+  static const f64 shape(const f64 x) noexcept { return cosine_segment(x); }
+};
+
+// Fast at first and slow towards the target, like a decaying level
+struct ExponentialInterpolation {
+  static constexpr Interpolation TYPE = Interpolation::Exponential;
+  static constexpr f64 RATE = 5.; // k, in 1 / duration
+
+  static const f64 shape(const f64 x) noexcept
+  {
+    return EXPONENTIAL_SEGMENT_TABLE(x);
+  }
+};
+
+// Smoothstep: flat at both ends like Cosine, but without a table
+struct SCurveInterpolation {
+  static constexpr Interpolation TYPE = Interpolation::SCurve;
+  static const f64 shape(const f64 x) noexcept { return x * x * (3. - 2. * x); }
+};
+
+// Calls `f` with the policy for `interpolation` and returns its result
+template <typename F>
+inline decltype(auto) dispatch_interpolation(
+  const Interpolation interpolation,
+  F&& f)
 {
   switch (interpolation) {
-    case Interpolation::None:
-      return b;
     case Interpolation::Linear:
-      return clamp(a, b, lerp(a, b, t));
+      return f(LinearInterpolation());
     case Interpolation::Cosine:
-      return clamp(a, b, cerp(a, b, t));
-    default:
-      throw "unsupported Interpolation";
+      return f(CosineInterpolation());
+    case Interpolation::Exponential:
+      return f(ExponentialInterpolation());
+    case Interpolation::SCurve:
+      return f(SCurveInterpolation());
+    case Interpolation::None:
+      break;
   }
+  return f(StepInterpolation());
+}
+
+// Value a fraction `t` in [0, 1] of the way from `a` to `b`
+template <typename Policy>
+inline const f64 interpolate(const f64 a, const f64 b, const f64 t) noexcept
+{
+  return lerp(a, b, Policy::shape(t));
 }
 
 class TimeState;
@@ -103,4 +184,37 @@ private:
   Interpolation interpolation = Interpolation::None;
 };
 
+// Parameter ramping to its target at block rate: `render` writes a whole block
+// of values, stepping linearly or through the cosine segment table, and only
+// fills in the value once the target is reached. Durations are in the unit of
+// the `dt` passed to `render` and `skip`.
+class Smoothed {
+public:
+  Smoothed() {}
+  Smoothed(const f64 value) : from(value), target(value) {}
+
+  // Ramps from the current value to `target` over `duration`
+  void set(
+    const f64 target,
+    const f64 duration,
+    const Interpolation interpolation) noexcept;
+
+  const f64 get() const noexcept;
+  const f64 get_target() const noexcept { return target; }
+  const bool is_smoothing() const noexcept { return position < 1.; }
+
+  // Writes the next `num_frames` values, `dt` apart, to `out`
+  void render(const f64 dt, f64* out, const u32 num_frames) noexcept;
+
+  // Advances by `num_frames` values, `dt` apart, without writing them
+  void skip(const f64 dt, const u32 num_frames) noexcept;
+
+private:
+  f64 from = .0;
+  f64 target = .0;
+  f64 position = 1.; // from 0 to 1 while smoothing
+  f64 duration = .0;
+  Interpolation interpolation = Interpolation::None;
+};
+
 #endif
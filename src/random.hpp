@@ -0,0 +1,40 @@
+#ifndef IMP_RANDOM
+#define IMP_RANDOM
+
+#include "constants.hpp"
+
+// PCG32 (XSH RR variant, see pcg-random.org): 64 bits of state, 32 bit output.
+// Generators with the same seed but different streams produce independent
+// sequences, so every instrument instance can own one seeded from the song seed
+// and its index, and render reproducibly regardless of any other.
+class Pcg32 {
+public:
+  Pcg32(const u64 seed = 0, const u64 stream = 0) : increment((stream << 1) | 1)
+  {
+    next();
+    state += seed;
+    next();
+  }
+
+  const u32 next()
+  {
+    const u64 old_state = state;
+    state = old_state * 6364136223846793005ull + increment;
+    const u32 xorshifted = u32(((old_state >> 18) ^ old_state) >> 27);
+    const u32 rotation = u32(old_state >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+  }
+
+  // Returns a value in [0, bound), using Lemire's multiply-shift, which is
+  // faster than and at least as uniform as `next() % bound`
+  const u32 next_below(const u32 bound)
+  {
+    return u32((u64(next()) * bound) >> 32);
+  }
+
+private:
+  u64 state = 0;
+  u64 increment;
+};
+
+#endif
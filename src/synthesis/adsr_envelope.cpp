@@ -0,0 +1,94 @@
+#include "adsr_envelope.hpp"
+
+#include "math.hpp"
+
+#include <algorithm>
+
+void AdsrEnvelope::strike()
+{
+  enter(Segment::Attack);
+}
+
+void AdsrEnvelope::release()
+{
+  if (segment != Segment::Idle) {
+    enter(Segment::Release);
+  }
+}
+
+void AdsrEnvelope::enter(const Segment segment)
+{
+  this->segment = segment;
+  position = .0;
+  from = level;
+}
+
+const u32 AdsrEnvelope::render(
+  const AdsrParams& params,
+  const f64 dt,
+  sample_t* out,
+  const u32 num_frames)
+{
+  u32 i = 0;
+  while (i != num_frames) {
+    f64 duration = .0;
+    f64 to = .0;
+    Interpolation interpolation = Interpolation::None;
+    switch (segment) {
+      case Segment::Idle:
+        level = .0;
+        std::fill(out + i, out + num_frames, sample_t(0));
+        return i;
+      case Segment::Sustain:
+        level = params.sustain_amplitude;
+        std::fill(out + i, out + num_frames, sample_t(level));
+        return num_frames;
+      case Segment::Attack:
+        duration = params.attack_duration;
+        to = params.attack_amplitude;
+        interpolation = params.attack_interpolation;
+        break;
+      case Segment::Decay:
+        duration = params.decay_duration;
+        to = params.sustain_amplitude;
+        interpolation = params.decay_interpolation;
+        break;
+      case Segment::Release:
+        duration = params.release_duration;
+        interpolation = params.release_interpolation;
+        break;
+    }
+
+    // Segments without duration are skipped
+    if (duration <= .0) {
+      position = 1.;
+    }
+
+    // Shapes are picked per segment rather than per frame
+    const f64 increment = duration > .0 ? dt / duration : .0;
+    const f64 delta = to - from;
+    dispatch_interpolation(interpolation, [&](const auto policy) {
+      for (; i != num_frames && position < 1.; ++i) {
+        level = from + delta * decltype(policy)::shape(position);
+        out[i] = sample_t(level);
+        position += increment;
+      }
+    });
+
+    if (position >= 1.) {
+      level = to;
+      switch (segment) {
+        case Segment::Attack:
+          enter(Segment::Decay);
+          break;
+        case Segment::Decay:
+          enter(Segment::Sustain);
+          break;
+        default:
+          enter(Segment::Idle);
+          break;
+      }
+    }
+  }
+  return num_frames;
+}
@@ -0,0 +1,47 @@
+#ifndef IMP_ADSR_ENVELOPE
+#define IMP_ADSR_ENVELOPE
+
+#include "adsr_params.hpp"
+#include "constants.hpp"
+
+// ADSR envelope of one voice, generated incrementally: each segment advances a
+// position from 0 to 1 by a fixed increment per frame, computed once per
+// block, and shapes it through a precomputed cosine table (or linearly).
+// Segments start at the current level, so retriggers and releases never jump.
+class AdsrEnvelope {
+public:
+  enum class Segment : u8 { Idle, Attack, Decay, Sustain, Release };
+
+  // Starts the attack from the current level
+  void strike();
+
+  // Starts the release from the current level, unless finished
+  void release();
+
+  // Writes `num_frames` levels to `out`, `dt` (scaled) seconds apart. Returns
+  // how many frames were rendered before the envelope finished, the rest being
+  // zeros.
+  const u32 render(
+    const AdsrParams& params,
+    const f64 dt,
+    sample_t* out,
+    const u32 num_frames);
+
+  // True once the release has ended, or if the envelope never started
+  const bool is_finished() const { return segment == Segment::Idle; }
+
+  const Segment get_segment() const { return segment; }
+
+  // Level of the last rendered frame
+  const sample_t get_level() const { return sample_t(level); }
+
+private:
+  void enter(const Segment segment);
+
+  Segment segment = Segment::Idle;
+  f64 position = .0; // in the current segment, from 0 to 1
+  f64 from = .0;     // level at the start of the current segment
+  f64 level = .0;
+};
+
+#endif
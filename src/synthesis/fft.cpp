@@ -0,0 +1,67 @@
+#include "fft.hpp"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+// In place radix-2 inverse complex FFT of size 2^size_log2, unnormalized
+static void inverse_fft(std::complex<f64>* x, const u32 size_log2)
+{
+  const u32 size = 1u << size_log2;
+
+  // Bit reversal permutation
+  for (u32 i = 1, j = 0; i != size; ++i) {
+    u32 bit = size >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(x[i], x[j]);
+    }
+  }
+
+  // Twiddles of the last stage, which earlier stages read with a stride
+  std::vector<std::complex<f64>> twiddles(size / 2);
+  for (u32 k = 0; k != size / 2; ++k) {
+    twiddles[k] = std::polar(1., TWOPI * k / size);
+  }
+
+  for (u32 half = 1; half != size; half <<= 1) {
+    const u32 stride = size / (half << 1);
+    for (u32 start = 0; start != size; start += half << 1) {
+      for (u32 k = 0; k != half; ++k) {
+        const std::complex<f64> a = x[start + k];
+        const std::complex<f64> b = twiddles[k * stride] * x[start + k + half];
+        x[start + k] = a + b;
+        x[start + k + half] = a - b;
+      }
+    }
+  }
+}
+
+void inverse_real_fft(
+  const std::complex<f64>* spectrum,
+  const u32 size_log2,
+  f64* out)
+{
+  const u32 half_size = 1u << (size_log2 - 1);
+
+  // Pack even outputs into the real and odd outputs into the imaginary part of
+  // a half size transform: z[m] = out[2m] + i out[2m + 1]
+  std::vector<std::complex<f64>> z(half_size);
+  const std::complex<f64> i(0., 1.);
+  for (u32 k = 0; k != half_size; ++k) {
+    const std::complex<f64> a = spectrum[k];
+    const std::complex<f64> b = std::conj(spectrum[half_size - k]);
+    const std::complex<f64> w = std::polar(1., TWOPI * k / (2 * half_size));
+    z[k] = (a + b) + i * w * (a - b);
+  }
+
+  inverse_fft(z.data(), size_log2 - 1);
+
+  for (u32 m = 0; m != half_size; ++m) {
+    out[2 * m] = z[m].real();
+    out[2 * m + 1] = z[m].imag();
+  }
+}
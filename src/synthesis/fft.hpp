@@ -0,0 +1,17 @@
+#ifndef IMP_FFT
+#define IMP_FFT
+
+#include "constants.hpp"
+
+#include <complex>
+
+// Inverse real FFT of size 2^size_log2 (at least 4), without normalization:
+// out[n] = sum over all k of X[k] e^(2 pi i k n / size), where `spectrum` holds
+// X[0] to X[size / 2] and the other half is their conjugate mirror. Runs one
+// complex FFT of half the size.
+void inverse_real_fft(
+  const std::complex<f64>* spectrum,
+  const u32 size_log2,
+  f64* out);
+
+#endif
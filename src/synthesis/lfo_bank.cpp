@@ -0,0 +1,116 @@
+#include "lfo_bank.hpp"
+
+#include "math.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+LfoBank::LfoBank()
+{
+  // Every LFO holds its own sequence of random values
+  for (u32 lfo_ix = 0; lfo_ix != NUM_LFOS; ++lfo_ix) {
+    lfos[lfo_ix].random = Pcg32(0, lfo_ix);
+  }
+}
+
+void LfoBank::render(const f64 dt, Modulation& out, const u32 num_frames) const
+{
+  f64* destinations[u32(Destination::Count)] = {out.pitch, out.gain};
+  std::fill(out.pitch, out.pitch + num_frames, .0);
+  std::fill(out.gain, out.gain + num_frames, 1.);
+
+  alignas(64) f64 values[IMP_BLOCK_SIZE];
+  for (u32 lfo_ix = 0; lfo_ix != NUM_LFOS; ++lfo_ix) {
+    // Unrouted LFOs are not rendered
+    bool is_routed = false;
+    for (u32 d = 0; d != u32(Destination::Count); ++d) {
+      is_routed |= depths[d][lfo_ix] != .0;
+    }
+    if (!is_routed) {
+      continue;
+    }
+
+    render_lfo(lfos[lfo_ix], dt, values, num_frames);
+    for (u32 d = 0; d != u32(Destination::Count); ++d) {
+      const f64 depth = depths[d][lfo_ix];
+      if (depth == .0) {
+        continue;
+      }
+      f64* destination = destinations[d];
+      for (u32 i = 0; i != num_frames; ++i) {
+        destination[i] += depth * values[i];
+      }
+    }
+  }
+}
+
+void LfoBank::advance(const f64 dt, const u32 num_frames)
+{
+  for (Lfo& lfo : lfos) {
+    const f64 phase = lfo.phase + num_frames * dt * lfo.frequency;
+    const f64 num_cycles = std::floor(phase);
+    lfo.phase = phase - num_cycles;
+    if (lfo.shape == Shape::SampleAndHold) {
+      for (f64 cycle = .0; cycle < num_cycles; ++cycle) {
+        lfo.held = draw(lfo.random);
+      }
+    }
+  }
+}
+
+void LfoBank::render_lfo(
+  const Lfo& lfo,
+  const f64 dt,
+  f64* out,
+  const u32 num_frames)
+{
+  const f64 increment = dt * lfo.frequency;
+  switch (lfo.shape) {
+    case Shape::Sine: {
+      // Rotates a phasor rather than calling sin every frame
+      const f64 step_sin = sin(TWOPI * increment);
+      const f64 step_cos = cos(TWOPI * increment);
+      f64 s = sin(TWOPI * lfo.phase);
+      f64 c = cos(TWOPI * lfo.phase);
+      for (u32 i = 0; i != num_frames; ++i) {
+        out[i] = s;
+        const f64 next_s = s * step_cos + c * step_sin;
+        c = c * step_cos - s * step_sin;
+        s = next_s;
+      }
+      return;
+    }
+    case Shape::Triangle: {
+      f64 phase = lfo.phase;
+      for (u32 i = 0; i != num_frames; ++i) {
+        out[i] = phase < .25 ? 4. * phase
+          : phase < .75      ? 2. - 4. * phase
+                             : 4. * phase - 4.;
+        phase += increment;
+        if (phase >= 1.) {
+          phase -= 1.;
+        }
+      }
+      return;
+    }
+    case Shape::SampleAndHold: {
+      f64 phase = lfo.phase;
+      f64 held = lfo.held;
+      Pcg32 random = lfo.random;
+      for (u32 i = 0; i != num_frames; ++i) {
+        out[i] = held;
+        phase += increment;
+        if (phase >= 1.) {
+          phase -= 1.;
+          held = draw(random);
+        }
+      }
+      return;
+    }
+  }
+}
+
+const f64 LfoBank::draw(Pcg32& random)
+{
+  return random.next() * (2. / 4294967296.) - 1.;
+}
@@ -0,0 +1,84 @@
+#ifndef IMP_LFO_BANK
+#define IMP_LFO_BANK
+
+#include "constants.hpp"
+#include "random.hpp"
+
+// Modulation of all voices of a synth over one span, see LfoBank
+struct Modulation {
+  alignas(64) f64 pitch[IMP_BLOCK_SIZE]; // added to voice frequencies, in hz
+  alignas(64) f64 gain[IMP_BLOCK_SIZE];  // multiplies voice gains
+};
+
+// Low frequency oscillators of a synth, routed to voice parameters through a
+// modulation matrix of depths. Every routed LFO is rendered once per span and
+// shared by all voices, rather than evaluated per voice and frame.
+//
+// Like the voices, LFOs are rendered from a const synth; the renderer then
+// advances them past the span.
+class LfoBank {
+public:
+  static constexpr u32 NUM_LFOS = 4;
+
+  enum class Shape : u8 {
+    Sine,
+    Triangle,
+    SampleAndHold, // a new random value every cycle
+  };
+
+  enum class Destination : u8 {
+    Pitch, // depth in hz
+    Gain,  // depth as a fraction of the gain
+    Count,
+  };
+
+  LfoBank();
+
+  void set_shape(const u32 lfo_ix, const Shape shape)
+  {
+    lfos[lfo_ix].shape = shape;
+  }
+
+  // In hz of scaled time
+  void set_frequency(const u32 lfo_ix, const f64 frequency)
+  {
+    lfos[lfo_ix].frequency = frequency;
+  }
+
+  // LFO `lfo_ix`, from -1 to 1, times `depth` is added to `destination`. A
+  // depth of 0 removes the route.
+  void set_depth(
+    const u32 lfo_ix,
+    const Destination destination,
+    const f64 depth)
+  {
+    depths[u32(destination)][lfo_ix] = depth;
+  }
+
+  // Writes `num_frames` (at most IMP_BLOCK_SIZE) frames of modulation to `out`
+  void render(const f64 dt, Modulation& out, const u32 num_frames) const;
+
+  // Advances all LFOs by `num_frames` frames
+  void advance(const f64 dt, const u32 num_frames);
+
+private:
+  struct Lfo {
+    Shape shape = Shape::Sine;
+    f64 frequency = .0;
+    f64 phase = .0; // in cycles, from 0 to 1
+    f64 held = .0;  // value of SampleAndHold during this cycle
+    Pcg32 random;
+  };
+
+  // Value of `lfo` over `num_frames` frames
+  static void
+  render_lfo(const Lfo& lfo, const f64 dt, f64* out, const u32 num_frames);
+
+  // Draws the value SampleAndHold holds during the next cycle
+  static const f64 draw(Pcg32& random);
+
+  Lfo lfos[NUM_LFOS];
+  f64 depths[u32(Destination::Count)][NUM_LFOS] = {};
+};
+
+#endif
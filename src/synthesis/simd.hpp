@@ -0,0 +1,366 @@
+#ifndef IMP_SIMD
+#define IMP_SIMD
+
+#include "constants.hpp"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define IMP_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define IMP_SIMD_SSE2
+#endif
+
+// Oscillator phases of `WIDTH` lanes in 0.32 fixed point, i.e. 2^32 is one
+// cycle. Accumulating them is exact, and wrapping comes for free.
+template <u32 WIDTH>
+struct SimdPhase {
+  u32 lanes[WIDTH];
+
+  static SimdPhase load(const u32* p)
+  {
+    SimdPhase result;
+    std::memcpy(result.lanes, p, sizeof(result.lanes));
+    return result;
+  }
+
+  void store(u32* p) const { std::memcpy(p, lanes, sizeof(lanes)); }
+
+  friend SimdPhase operator+(SimdPhase a, const SimdPhase b)
+  {
+    for (u32 lane = 0; lane != WIDTH; ++lane) {
+      a.lanes[lane] += b.lanes[lane];
+    }
+    return a;
+  }
+};
+
+// Converts a (possibly negative) fraction of a cycle to fixed point phase,
+// rounding to nearest so that no bias accumulates
+inline const u32 to_fixed_phase(const f64 cycles)
+{
+  const f64 fixed = cycles * 4294967296.;
+  return u32(i64(fixed + (fixed < .0 ? -.5 : .5)));
+}
+
+// Per lane choice of a table among power-of-two tables stored back to back:
+// lane `lane` reads the 2^size_log2[lane] entries at offset[lane]
+template <u32 WIDTH>
+struct SimdTables {
+  u32 offset[WIDTH];
+  u32 size_log2[WIDTH];
+};
+
+// Indices of `WIDTH` lanes into a buffer, e.g. of tables
+template <u32 WIDTH>
+struct SimdIndex {
+  u32 lanes[WIDTH];
+};
+
+// Finds, at every lane of `phase`, the sample at or before it in that lane's
+// table of `tables`, writing its index to `ix` and how far past it the phase
+// is, in [0, 1), to `t`
+template <typename T, u32 WIDTH>
+inline void locate_lanes(
+  const SimdTables<WIDTH>& tables,
+  const SimdPhase<WIDTH>& phase,
+  u32* ix,
+  T* t)
+{
+  // The fraction is taken as 31 bits so that SIMD code can convert it signed
+  const T scale = T(1) / T(1u << 31);
+  for (u32 lane = 0; lane != WIDTH; ++lane) {
+    const u32 size_log2 = tables.size_log2[lane];
+    ix[lane] = tables.offset[lane] + (phase.lanes[lane] >> (32 - size_log2));
+    t[lane] = T((phase.lanes[lane] << size_log2) >> 1) * scale;
+  }
+}
+
+// The widest vector of `T` the target supports. Kernels are written against
+// this so that they compile to AVX2, SSE2 or plain scalar code alike; build
+// with IMP_SIMD_NATIVE to get AVX2.
+template <typename T>
+struct Simd;
+
+template <>
+struct Simd<f64> {
+#if defined(IMP_SIMD_AVX2)
+  static constexpr u32 WIDTH = 4;
+  using Native = __m256d;
+#elif defined(IMP_SIMD_SSE2)
+  static constexpr u32 WIDTH = 2;
+  using Native = __m128d;
+#else
+  static constexpr u32 WIDTH = 1;
+  using Native = f64;
+#endif
+  static constexpr size_t ALIGNMENT = WIDTH * sizeof(f64);
+  using Phase = SimdPhase<WIDTH>;
+  using Tables = SimdTables<WIDTH>;
+#if defined(IMP_SIMD_AVX2)
+  using Index = __m128i;
+#else
+  using Index = SimdIndex<WIDTH>;
+#endif
+
+  Native v;
+
+  static Simd broadcast(const f64 value)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_set1_pd(value)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_set1_pd(value)};
+#else
+    return {value};
+#endif
+  }
+
+  // NOTE: `p` must be aligned to ALIGNMENT
+  static Simd load(const f64* p)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_load_pd(p)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_load_pd(p)};
+#else
+    return {*p};
+#endif
+  }
+
+  // NOTE: `p` must be aligned to ALIGNMENT
+  void store(f64* p) const
+  {
+#if defined(IMP_SIMD_AVX2)
+    _mm256_store_pd(p, v);
+#elif defined(IMP_SIMD_SSE2)
+    _mm_store_pd(p, v);
+#else
+    *p = v;
+#endif
+  }
+
+  friend Simd operator+(const Simd a, const Simd b)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_add_pd(a.v, b.v)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_add_pd(a.v, b.v)};
+#else
+    return {a.v + b.v};
+#endif
+  }
+
+  friend Simd operator-(const Simd a, const Simd b)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_sub_pd(a.v, b.v)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_sub_pd(a.v, b.v)};
+#else
+    return {a.v - b.v};
+#endif
+  }
+
+  friend Simd operator*(const Simd a, const Simd b)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_mul_pd(a.v, b.v)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_mul_pd(a.v, b.v)};
+#else
+    return {a.v * b.v};
+#endif
+  }
+
+  // See locate_lanes
+  static void
+  locate(const Tables& tables, const Phase& phase, Index& ix, Simd& t)
+  {
+#if defined(IMP_SIMD_AVX2)
+    const __m128i p = _mm_loadu_si128((const __m128i*)phase.lanes);
+    const __m128i size_log2 = _mm_loadu_si128((const __m128i*)tables.size_log2);
+    ix = _mm_add_epi32(
+      _mm_loadu_si128((const __m128i*)tables.offset),
+      _mm_srlv_epi32(p, _mm_sub_epi32(_mm_set1_epi32(32), size_log2)));
+    t.v = _mm256_mul_pd(
+      _mm256_cvtepi32_pd(_mm_srli_epi32(_mm_sllv_epi32(p, size_log2), 1)),
+      _mm256_set1_pd(1. / f64(1u << 31)));
+#else
+    alignas(ALIGNMENT) f64 lanes[WIDTH];
+    locate_lanes(tables, phase, ix.lanes, lanes);
+    t = load(lanes);
+#endif
+  }
+
+  // Reads `buffer` at the index of every lane
+  static Simd gather(const f64* buffer, const Index& ix)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_i32gather_pd(buffer, ix, sizeof(f64))};
+#else
+    alignas(ALIGNMENT) f64 lanes[WIDTH];
+    for (u32 lane = 0; lane != WIDTH; ++lane) {
+      lanes[lane] = buffer[ix.lanes[lane]];
+    }
+    return load(lanes);
+#endif
+  }
+
+  const f64 sum() const
+  {
+    alignas(ALIGNMENT) f64 lanes[WIDTH];
+    store(lanes);
+    f64 result = .0;
+    for (u32 lane = 0; lane != WIDTH; ++lane) {
+      result += lanes[lane];
+    }
+    return result;
+  }
+};
+
+template <>
+struct Simd<f32> {
+#if defined(IMP_SIMD_AVX2)
+  static constexpr u32 WIDTH = 8;
+  using Native = __m256;
+#elif defined(IMP_SIMD_SSE2)
+  static constexpr u32 WIDTH = 4;
+  using Native = __m128;
+#else
+  static constexpr u32 WIDTH = 1;
+  using Native = f32;
+#endif
+  static constexpr size_t ALIGNMENT = WIDTH * sizeof(f32);
+  using Phase = SimdPhase<WIDTH>;
+  using Tables = SimdTables<WIDTH>;
+#if defined(IMP_SIMD_AVX2)
+  using Index = __m256i;
+#else
+  using Index = SimdIndex<WIDTH>;
+#endif
+
+  Native v;
+
+  static Simd broadcast(const f32 value)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_set1_ps(value)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_set1_ps(value)};
+#else
+    return {value};
+#endif
+  }
+
+  // NOTE: `p` must be aligned to ALIGNMENT
+  static Simd load(const f32* p)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_load_ps(p)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_load_ps(p)};
+#else
+    return {*p};
+#endif
+  }
+
+  // NOTE: `p` must be aligned to ALIGNMENT
+  void store(f32* p) const
+  {
+#if defined(IMP_SIMD_AVX2)
+    _mm256_store_ps(p, v);
+#elif defined(IMP_SIMD_SSE2)
+    _mm_store_ps(p, v);
+#else
+    *p = v;
+#endif
+  }
+
+  friend Simd operator+(const Simd a, const Simd b)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_add_ps(a.v, b.v)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_add_ps(a.v, b.v)};
+#else
+    return {a.v + b.v};
+#endif
+  }
+
+  friend Simd operator-(const Simd a, const Simd b)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_sub_ps(a.v, b.v)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_sub_ps(a.v, b.v)};
+#else
+    return {a.v - b.v};
+#endif
+  }
+
+  friend Simd operator*(const Simd a, const Simd b)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_mul_ps(a.v, b.v)};
+#elif defined(IMP_SIMD_SSE2)
+    return {_mm_mul_ps(a.v, b.v)};
+#else
+    return {a.v * b.v};
+#endif
+  }
+
+  // See locate_lanes
+  static void
+  locate(const Tables& tables, const Phase& phase, Index& ix, Simd& t)
+  {
+#if defined(IMP_SIMD_AVX2)
+    const __m256i p = _mm256_loadu_si256((const __m256i*)phase.lanes);
+    const __m256i size_log2 =
+      _mm256_loadu_si256((const __m256i*)tables.size_log2);
+    ix = _mm256_add_epi32(
+      _mm256_loadu_si256((const __m256i*)tables.offset),
+      _mm256_srlv_epi32(
+        p,
+        _mm256_sub_epi32(_mm256_set1_epi32(32), size_log2)));
+    t.v = _mm256_mul_ps(
+      _mm256_cvtepi32_ps(_mm256_srli_epi32(_mm256_sllv_epi32(p, size_log2), 1)),
+      _mm256_set1_ps(1.f / f32(1u << 31)));
+#else
+    alignas(ALIGNMENT) f32 lanes[WIDTH];
+    locate_lanes(tables, phase, ix.lanes, lanes);
+    t = load(lanes);
+#endif
+  }
+
+  // Reads `buffer` at the index of every lane
+  static Simd gather(const f32* buffer, const Index& ix)
+  {
+#if defined(IMP_SIMD_AVX2)
+    return {_mm256_i32gather_ps(buffer, ix, sizeof(f32))};
+#else
+    alignas(ALIGNMENT) f32 lanes[WIDTH];
+    for (u32 lane = 0; lane != WIDTH; ++lane) {
+      lanes[lane] = buffer[ix.lanes[lane]];
+    }
+    return load(lanes);
+#endif
+  }
+
+  const f32 sum() const
+  {
+    alignas(ALIGNMENT) f32 lanes[WIDTH];
+    store(lanes);
+    f32 result = .0f;
+    for (u32 lane = 0; lane != WIDTH; ++lane) {
+      result += lanes[lane];
+    }
+    return result;
+  }
+};
+
+using SimdSample = Simd<sample_t>;
+
+#endif
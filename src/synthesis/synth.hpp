@@ -2,22 +2,18 @@
 #define IMP_SYNTH
 
 #include "adsr_params.hpp"
-#include "voice.hpp"
-#include "wavetable.hpp"
-
-// TODO
-struct imp_vibrato {
-  f64 amp;  // TODO (feat): type to ensure in hz
-  f64 freq; // TODO (feat): type to ensure in samples
-};
+#include "lfo_bank.hpp"
+#include "voice_bank.hpp"
+#include "wavetable_bank.hpp"
+#include "wavetable_registry.hpp"
 
 struct Synth {
-  static constexpr size_t NUM_VOICES = 32;
-  f64 lfo;
-  HarmonicsWavetable wavetable;
-  Voice voices[NUM_VOICES];
+  WavetableRegistry::Handle wavetable; // shared, see WavetableRegistry
+  // Played instead of `wavetable` if set, morphing per voice
+  std::shared_ptr<const WavetableBank> wavetable_bank;
+  VoiceBank voices;
   AdsrParams adsr_params;
-  imp_vibrato vibrato;
+  LfoBank lfos; // LFO 0 is the vibrato, see Command::Parameter
 };
 
 #endif
@@ -0,0 +1,165 @@
+#ifndef IMP_VOICE_ALLOCATOR
+#define IMP_VOICE_ALLOCATOR
+
+#include "constants.hpp"
+
+#include <bitset>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Which voice a strike takes over when no voice is free
+enum class StealPolicy : u8 {
+  Oldest,   // the voice struck longest ago
+  Quietest, // the voice with the lowest envelope level
+  SameNote, // like Oldest, but a note that still sounds is retriggered in place
+};
+
+// Bookkeeping of which voices of a bank are in use, in constant time per
+// operation:
+// - free voices are bits of a mask, and the lowest one is allocated first so
+//   that active voices stay packed into as few SIMD groups as possible
+// - active voices form a list ordered by strike time, oldest first
+// - every note maps to the voice that most recently struck it
+template <u32 NUM_VOICES>
+class VoiceAllocator {
+public:
+  static_assert(NUM_VOICES <= 32, "voice masks are 32 bits wide");
+  static constexpr u8 NO_VOICE = 0xff;
+  static constexpr u32 NUM_NOTES = 128; // MIDI note range
+
+  VoiceAllocator()
+  {
+    for (u8& voice_ix : note_voice) {
+      voice_ix = NO_VOICE;
+    }
+    for (u8& note : voice_note) {
+      note = NO_NOTE;
+    }
+  }
+
+  // Returns NO_VOICE if no voice has struck `note` since it was last freed
+  const u32 find_note(const u8 note) const { return note_voice[note]; }
+
+  const u32 get_active_mask() const { return ~free_mask & ALL_VOICES; }
+
+  const u32 get_num_active() const
+  {
+    return u32(std::bitset<32>(get_active_mask()).count());
+  }
+
+  // Takes the lowest free voice, or steals one according to `policy`. The
+  // voice is unmapped from its previous note and becomes the newest.
+  // `levels` are the current envelope levels of all voices.
+  const u32 allocate(const StealPolicy policy, const sample_t* levels)
+  {
+    u32 voice_ix;
+    if (free_mask != 0) {
+      voice_ix = count_trailing_zeros(free_mask);
+      free_mask &= ~(1u << voice_ix);
+    }
+    else {
+      voice_ix =
+        policy == StealPolicy::Quietest ? find_quietest(levels) : oldest;
+      unlink(voice_ix);
+      unmap(voice_ix);
+    }
+    append(voice_ix);
+    return voice_ix;
+  }
+
+  // Maps `note` to `voice_ix`, which must be active, and makes it the newest
+  void assign(const u32 voice_ix, const u8 note)
+  {
+    unmap(voice_ix);
+    note_voice[note] = u8(voice_ix);
+    voice_note[voice_ix] = note;
+    unlink(voice_ix);
+    append(voice_ix);
+  }
+
+  // Returns `voice_ix` to the free voices once it has fallen silent
+  void free(const u32 voice_ix)
+  {
+    unlink(voice_ix);
+    unmap(voice_ix);
+    free_mask |= 1u << voice_ix;
+  }
+
+private:
+  static constexpr u32 ALL_VOICES = u32((u64(1) << NUM_VOICES) - 1);
+  static constexpr u8 NO_NOTE = 0xff;
+
+  static const u32 count_trailing_zeros(const u32 mask)
+  {
+#ifdef _MSC_VER
+    unsigned long ix;
+    _BitScanForward(&ix, mask);
+    return u32(ix);
+#else
+    return u32(__builtin_ctz(mask));
+#endif
+  }
+
+  // Only used when stealing, so it may scan the active voices
+  const u32 find_quietest(const sample_t* levels) const
+  {
+    u32 quietest = oldest;
+    for (u32 voice_ix = next[oldest]; voice_ix != NO_VOICE;
+         voice_ix = next[voice_ix]) {
+      if (levels[voice_ix] < levels[quietest]) {
+        quietest = voice_ix;
+      }
+    }
+    return quietest;
+  }
+
+  void append(const u32 voice_ix)
+  {
+    prev[voice_ix] = u8(newest);
+    next[voice_ix] = NO_VOICE;
+    if (newest != NO_VOICE) {
+      next[newest] = u8(voice_ix);
+    }
+    else {
+      oldest = voice_ix;
+    }
+    newest = voice_ix;
+  }
+
+  void unlink(const u32 voice_ix)
+  {
+    if (prev[voice_ix] != NO_VOICE) {
+      next[prev[voice_ix]] = next[voice_ix];
+    }
+    else {
+      oldest = next[voice_ix];
+    }
+    if (next[voice_ix] != NO_VOICE) {
+      prev[next[voice_ix]] = prev[voice_ix];
+    }
+    else {
+      newest = prev[voice_ix];
+    }
+  }
+
+  void unmap(const u32 voice_ix)
+  {
+    const u8 note = voice_note[voice_ix];
+    if (note != NO_NOTE && note_voice[note] == voice_ix) {
+      note_voice[note] = NO_VOICE;
+    }
+    voice_note[voice_ix] = NO_NOTE;
+  }
+
+  u32 free_mask = ALL_VOICES;
+  u32 oldest = NO_VOICE;
+  u32 newest = NO_VOICE;
+  u8 prev[NUM_VOICES] = {};
+  u8 next[NUM_VOICES] = {};
+  u8 voice_note[NUM_VOICES];
+  u8 note_voice[NUM_NOTES];
+};
+
+#endif
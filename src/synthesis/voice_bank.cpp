@@ -0,0 +1,197 @@
+#include "voice_bank.hpp"
+#include "synth.hpp"
+
+#include "constants.hpp"
+#include "math.hpp"
+
+#include <algorithm>
+
+void VoiceBank::strike(
+  const u8 note,
+  const f64 frequency,
+  const f64 interpolation_duration,
+  const Interpolation interpolation)
+{
+  u32 voice_ix = allocator.find_note(note);
+  if (
+    voice_ix == allocator.NO_VOICE || steal_policy != StealPolicy::SameNote) {
+    if (voice_ix != allocator.NO_VOICE && state[voice_ix] == State::On) {
+      release_voice(voice_ix);
+    }
+    voice_ix = allocator.allocate(steal_policy, level);
+  }
+  allocator.assign(voice_ix, note);
+
+  this->frequency[voice_ix].set(
+    frequency, interpolation_duration, interpolation);
+  morph[voice_ix] = 0;
+  envelopes[voice_ix].strike();
+  state[voice_ix] = State::On;
+}
+
+void VoiceBank::set_morph(const u8 note, const f64 position)
+{
+  const u32 voice_ix = allocator.find_note(note);
+  if (voice_ix != allocator.NO_VOICE) {
+    morph[voice_ix] = sample_t(position);
+  }
+}
+
+void VoiceBank::release(const u8 note)
+{
+  const u32 voice_ix = allocator.find_note(note);
+  if (voice_ix != allocator.NO_VOICE && state[voice_ix] == State::On) {
+    release_voice(voice_ix);
+  }
+}
+
+void VoiceBank::release_voice(const u32 voice_ix)
+{
+  // The release starts from the current level, even if still in attack or
+  // decay, so that it does not jump
+  envelopes[voice_ix].release();
+  state[voice_ix] = State::Releasing;
+}
+
+void VoiceBank::render(
+  const Synth& synth,
+  const TimeState& time_state,
+  sample_t* out,
+  const u32 num_frames)
+{
+  constexpr u32 W = SimdSample::WIDTH;
+  constexpr u32 GROUP_MASK = (1u << W) - 1;
+
+  const f64 dt = time_state.get_scaled_delta_time();
+  Modulation modulation;
+  alignas(64) f64 gains[IMP_BLOCK_SIZE];
+
+  // Per-frame lanes: [frame * W + lane]
+  alignas(64) sample_t envelope[IMP_BLOCK_SIZE * W];
+  alignas(64) u32 increment[IMP_BLOCK_SIZE * W];
+  alignas(64) sample_t mix[IMP_BLOCK_SIZE * W];
+  bool mixed = false;
+
+  const u32 active_mask = allocator.get_active_mask();
+  for (u32 group_ix = 0; group_ix != NUM_VOICES; group_ix += W) {
+    // Skip groups where every voice is off
+    if (((active_mask >> group_ix) & GROUP_MASK) == 0) {
+      continue;
+    }
+
+    if (!mixed) {
+      // Modulation and gain are the same for every voice, so only compute
+      // them once per block
+      synth.lfos.render(dt, modulation, num_frames);
+      gain.render(dt, gains, num_frames);
+      for (u32 i = 0; i != num_frames; ++i) {
+        gains[i] *= modulation.gain[i];
+      }
+
+      std::fill(mix, mix + num_frames * W, sample_t(0));
+      mixed = true;
+    }
+
+    // Each voice reads the level band-limited for its highest frequency in
+    // this block
+    u32 levels[W];
+    for (u32 lane = 0; lane != W; ++lane) {
+      levels[lane] = HarmonicsWavetable::get_level(prepare_lane(
+        synth,
+        dt,
+        modulation.pitch,
+        gains,
+        group_ix + lane,
+        lane,
+        envelope,
+        increment,
+        num_frames));
+    }
+
+    // Kernel: sample, apply envelope, then advance phase
+    const auto kernel = [&](const auto& sample) {
+      SimdSample::Phase group_phase =
+        SimdSample::Phase::load(phase + group_ix);
+      for (u32 i = 0; i != num_frames; ++i) {
+        const SimdSample amplitude =
+          SimdSample::load(envelope + i * W) * sample(group_phase);
+        (SimdSample::load(mix + i * W) + amplitude).store(mix + i * W);
+        group_phase =
+          group_phase + SimdSample::Phase::load(increment + i * W);
+      }
+      group_phase.store(phase + group_ix);
+    };
+
+    const SimdSample::Tables tables = HarmonicsWavetable::get_tables(levels);
+    if (synth.wavetable_bank) {
+      const WavetableBank& bank = *synth.wavetable_bank;
+      const WavetableBank::Morph group_morph =
+        bank.get_morph(tables, morph + group_ix);
+      kernel([&](const SimdSample::Phase& group_phase) {
+        return bank.sample(group_morph, group_phase);
+      });
+    }
+    else {
+      const HarmonicsWavetable& wavetable = *synth.wavetable;
+      kernel([&](const SimdSample::Phase& group_phase) {
+        return wavetable.sample(tables, group_phase);
+      });
+    }
+  }
+
+  if (!mixed) {
+    return;
+  }
+
+  for (u32 i = 0; i != num_frames; ++i) {
+    out[i] += SimdSample::load(mix + i * W).sum();
+  }
+}
+
+const u32 VoiceBank::prepare_lane(
+  const Synth& synth,
+  const f64 dt,
+  const f64* pitch,
+  const f64* gains,
+  const u32 voice_ix,
+  const u32 lane,
+  sample_t* envelope,
+  u32* increment,
+  const u32 num_frames)
+{
+  constexpr u32 W = SimdSample::WIDTH;
+
+  // Frames after the envelope finishes are zeros
+  alignas(64) sample_t levels[IMP_BLOCK_SIZE];
+  AdsrEnvelope& voice_envelope = envelopes[voice_ix];
+  const u32 num_sounding =
+    voice_envelope.render(synth.adsr_params, dt, levels, num_frames);
+  level[voice_ix] = voice_envelope.get_level();
+
+  alignas(64) f64 frequencies[IMP_BLOCK_SIZE];
+  frequency[voice_ix].render(dt, frequencies, num_sounding);
+
+  u32 max_increment = 0;
+  u32 i = 0;
+  for (; i != num_sounding; ++i) {
+    envelope[i * W + lane] = sample_t(levels[i] * gains[i]);
+    const u32 voice_increment =
+      to_fixed_phase(dt * (pitch[i] + frequencies[i]));
+    increment[i * W + lane] = voice_increment;
+    // Negative frequencies run backwards through the same harmonics
+    max_increment = max(
+      max_increment,
+      i32(voice_increment) < 0 ? 0u - voice_increment : voice_increment);
+  }
+
+  for (; i != num_frames; ++i) {
+    envelope[i * W + lane] = 0;
+    increment[i * W + lane] = 0;
+  }
+
+  if (voice_envelope.is_finished()) {
+    state[voice_ix] = State::Off;
+    allocator.free(voice_ix);
+  }
+  return max_increment;
+}
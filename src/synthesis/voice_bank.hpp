@@ -0,0 +1,98 @@
+#ifndef IMP_VOICE_BANK
+#define IMP_VOICE_BANK
+
+#include "adsr_envelope.hpp"
+#include "constants.hpp"
+#include "lfo_bank.hpp"
+#include "math.hpp"
+#include "simd.hpp"
+#include "time_state.hpp"
+#include "voice_allocator.hpp"
+
+struct Synth;
+
+// All voices of a synth, stored as structure of arrays so that the render
+// kernel can advance and sample SimdSample::WIDTH voices per instruction.
+// Voices are addressed by the note they play.
+class VoiceBank {
+public:
+  static constexpr u32 NUM_VOICES = 32;
+  static_assert(NUM_VOICES % SimdSample::WIDTH == 0);
+
+  // Gain changes ramp over this long (in scaled time) rather than click
+  static constexpr f64 GAIN_SMOOTHING_DURATION = .02;
+
+  // TODO (feat): remove Releasing?
+  enum class State : u8 { Off, On, Releasing };
+
+  // Strikes `note` on a free voice, or steals one if all are in use. Unless
+  // the steal policy retriggers it, a note that is still on gets released.
+  // The voice glides from its previous frequency over `interpolation_duration`.
+  void strike(
+    const u8 note,
+    const f64 frequency,
+    const f64 interpolation_duration,
+    const Interpolation interpolation);
+
+  // Releases the voice playing `note`, if it is still on
+  void release(const u8 note);
+
+  // Sets the morph position (see WavetableBank) of the voice playing `note`,
+  // if any. Voices start at 0.
+  void set_morph(const u8 note, const f64 position);
+
+  // Sets the gain of all voices, ramping to it. Defaults to .25.
+  void set_gain(const f64 gain)
+  {
+    this->gain.set(gain, GAIN_SMOOTHING_DURATION, Interpolation::Linear);
+  }
+
+  const u32 get_num_active_voices() const
+  {
+    return allocator.get_num_active();
+  }
+
+  void set_steal_policy(const StealPolicy steal_policy)
+  {
+    this->steal_policy = steal_policy;
+  }
+
+  // Accumulates `num_frames` (at most IMP_BLOCK_SIZE) frames of all voices
+  // into `out`, starting at `time_state`
+  void render(
+    const Synth& synth,
+    const TimeState& time_state,
+    sample_t* out,
+    const u32 num_frames);
+
+private:
+  void release_voice(const u32 voice_ix);
+
+  // Fills lane `lane` of the interleaved `envelope` and `increment` buffers
+  // with what voice `voice_ix` needs in the kernel, the envelope including
+  // `gains` and the increment `pitch` modulation (in hz). Frames after the
+  // voice turns off get zeros, which leaves its phase untouched. Returns the
+  // largest phase increment magnitude of the voice.
+  const u32 prepare_lane(
+    const Synth& synth,
+    const f64 dt,
+    const f64* pitch,
+    const f64* gains,
+    const u32 voice_ix,
+    const u32 lane,
+    sample_t* envelope,
+    u32* increment,
+    const u32 num_frames);
+
+  alignas(64) u32 phase[NUM_VOICES] = {}; // see SimdPhase
+  sample_t morph[NUM_VOICES] = {};
+  sample_t level[NUM_VOICES] = {}; // last envelope value, for stealing
+  AdsrEnvelope envelopes[NUM_VOICES];
+  Smoothed frequency[NUM_VOICES];
+  Smoothed gain = .25;
+  State state[NUM_VOICES] = {};
+  VoiceAllocator<NUM_VOICES> allocator;
+  StealPolicy steal_policy = StealPolicy::Oldest;
+};
+
+#endif
@@ -2,41 +2,164 @@
 #define IMP_WAVETABLE
 
 #include "constants.hpp"
+#include "fft.hpp"
 #include "math.hpp"
+#include "simd.hpp"
+#include "wavetable_kernels.hpp"
 
+#include <algorithm>
+#include <complex>
 #include <iostream>
 #include <vector>
 
+// Band-limited wavetable, mipmapped per octave of the fundamental. Level
+// `level` serves voices advancing by up to 2^(level - 7) cycles per frame and
+// only keeps the harmonics that stay at or below Nyquist there, so that no
+// note aliases. Higher levels have fewer harmonics and smaller tables.
+//
+// Every level is padded with guard points, copies of its wrapped-around
+// neighbours, so that interpolation kernels read taps without masking.
+//
+// NOTE: Harmonics beyond MAX_HARMONICS are dropped, even for low notes
 class HarmonicsWavetable {
 public:
-  HarmonicsWavetable() {}
-  HarmonicsWavetable(std::vector<f64> harmonics) { fill(harmonics); }
+  static constexpr u32 NUM_LEVELS = 7;
+  static constexpr u32 MAX_HARMONICS = 1 << (NUM_LEVELS - 1);
+
+  constexpr HarmonicsWavetable() {}
+  HarmonicsWavetable(const std::vector<f64>& harmonics) { fill(harmonics); }
   HarmonicsWavetable(std::initializer_list<f64> harmonics) { fill(harmonics); }
 
-  void fill(std::vector<f64> harmonics)
+  // Overwrites every level with `harmonics`, through one inverse FFT per level
+  void fill(const std::vector<f64>& harmonics)
   {
-    // Precompute harmonics normalization factor n
+    // Normalize over all harmonics so that every level plays them at the same
+    // amplitude
     f64 n = .0;
     for (f64 amplitude : harmonics) {
       n += amplitude;
     }
     n = 1. / n;
 
-    auto N = harmonics.size();
+    std::vector<std::complex<f64>> spectrum(BUF_SIZE / 2 + 1);
+    std::vector<f64> table(BUF_SIZE);
+    for (u32 level = 0; level != NUM_LEVELS; ++level) {
+      const u32 size_log2 = get_size_log2(level);
+      const u32 N = min(u32(harmonics.size()), get_num_harmonics(level));
 
-    // Fill the wavetable
-    for (u32 i = 0; i != BUF_SIZE; ++i) {
+      // -i a / 2 at bin k and its mirrored conjugate make a sine of amplitude a
+      std::fill(spectrum.begin(), spectrum.end(), std::complex<f64>());
       for (u32 k = 0; k != N; ++k) {
-        buffer[i] += n * harmonics[k] * sin(C * i * (k + 1));
+        spectrum[k + 1] = {.0, -.5 * n * harmonics[k]};
       }
+      inverse_real_fft(spectrum.data(), size_log2, table.data());
+
+      std::copy(
+        table.begin(),
+        table.begin() + (1u << size_log2),
+        buffer + get_offset(level));
+      pad(level);
+    }
+  }
+
+  // Bakes harmonics `amplitude(k)`, for k from 1 to MAX_HARMONICS, at compile
+  // time when used in a constant expression. Instead of calling trig, every
+  // harmonic reads one shared sine table.
+  template <typename Amplitude>
+  static constexpr HarmonicsWavetable bake(const Amplitude amplitude)
+  {
+    f64 sines[BUF_SIZE] = {};
+    for (u32 i = 0; i != BUF_SIZE; ++i) {
+      sines[i] = get_sine(i, BUF_SIZE);
+    }
+
+    f64 n = .0;
+    for (u32 k = 1; k <= MAX_HARMONICS; ++k) {
+      n += amplitude(k);
+    }
+    n = 1. / n;
+
+    HarmonicsWavetable wavetable;
+    for (u32 level = 0; level != NUM_LEVELS; ++level) {
+      const u32 size_log2 = get_size_log2(level);
+      const u32 stride = BUF_SIZE >> size_log2;
+      sample_t* table = wavetable.buffer + get_offset(level);
+      for (u32 i = 0; i != 1u << size_log2; ++i) {
+        f64 value = .0;
+        for (u32 k = 1; k <= get_num_harmonics(level); ++k) {
+          value += n * amplitude(k) * sines[(i * k * stride) & (BUF_SIZE - 1)];
+        }
+        table[i] = sample_t(value);
+      }
+      wavetable.pad(level);
+    }
+    return wavetable;
+  }
+
+  template <size_t N>
+  static constexpr HarmonicsWavetable bake(const f64 (&harmonics)[N])
+  {
+    return bake(
+      [&harmonics](const u32 k) { return k <= N ? harmonics[k - 1] : .0; });
+  }
+
+  // Level for a voice advancing by up to `increment` (see SimdPhase) per frame
+  static const u32 get_level(const u32 increment)
+  {
+    u32 level = 0;
+    while (level != NUM_LEVELS - 1 &&
+           increment > (1u << (32 - NUM_LEVELS + level))) {
+      ++level;
+    }
+    return level;
+  }
+
+  // Tables of `levels`, one per lane, for `sample`. Their offsets point at the
+  // guard points before the levels, where kernels read their first taps.
+  static const SimdSample::Tables get_tables(const u32* levels)
+  {
+    SimdSample::Tables tables;
+    for (u32 lane = 0; lane != SimdSample::WIDTH; ++lane) {
+      tables.offset[lane] = get_offset(levels[lane]) - GUARD_BEFORE;
+      tables.size_log2[lane] = get_size_log2(levels[lane]);
     }
+    return tables;
   }
 
+  // Samples of every level, guard points included, as indexed by get_tables
+  const sample_t* get_data() const { return buffer; }
+  static constexpr u32 get_data_size() { return TOTAL_SIZE; }
+  static const u32 get_level_offset(const u32 level)
+  {
+    return get_offset(level);
+  }
+  static const u32 get_level_size_log2(const u32 level)
+  {
+    return get_size_log2(level);
+  }
+
+  // Samples the lowest level at `t` cycles
+  template <typename Kernel = WavetableKernel>
   const f64 sample(const f64 t) const
   {
-    const f64 ixf = (t - u32(t)) * BUF_SIZE;
-    const u32 ix = u32(ixf) % BUF_SIZE;
-    return lerp(buffer[ix], buffer[(ix + 1) % BUF_SIZE], ixf - ix);
+    constexpr u32 FRAC_BITS = 32 - BUF_SIZE_LOG2;
+    const u32 phase = to_fixed_phase(t);
+    const u32 ix = phase >> FRAC_BITS;
+    const f64 frac =
+      f64(phase & ((1u << FRAC_BITS) - 1)) / f64(1u << FRAC_BITS);
+    return Kernel::sample(buffer + get_offset(0) - GUARD_BEFORE + ix, frac);
+  }
+
+  // Samples every lane of `phase` at once, each in its own table of `tables`
+  template <typename Kernel = WavetableKernel>
+  const SimdSample sample(
+    const SimdSample::Tables& tables,
+    const SimdSample::Phase& phase) const
+  {
+    SimdSample::Index ix;
+    SimdSample t;
+    SimdSample::locate(tables, phase, ix, t);
+    return Kernel::gather(buffer, ix, t);
   }
 
   void dbg_print()
@@ -59,10 +182,75 @@ public:
   }
 
 private:
-  constexpr static size_t BUF_SIZE = 1024;
-  constexpr static f64 C = TWOPI / BUF_SIZE;
+  constexpr static u32 BUF_SIZE_LOG2 = 10;
+  constexpr static size_t BUF_SIZE = 1 << BUF_SIZE_LOG2;
+  // Tables are never smaller, so that low harmonic counts still interpolate
+  // well
+  constexpr static u32 MIN_SIZE_LOG2 = 6;
+  // Taps kernels may read before and after a level (see WavetableKernel)
+  constexpr static u32 GUARD_BEFORE = 1;
+  constexpr static u32 GUARD_AFTER = 2;
+
+  // Harmonics at or below Nyquist at the top of the octave of `level`
+  static constexpr u32 get_num_harmonics(const u32 level)
+  {
+    return MAX_HARMONICS >> level;
+  }
+
+  // 16 frames per cycle of the highest harmonic keep the lerp error small
+  static constexpr u32 get_size_log2(const u32 level)
+  {
+    return level + MIN_SIZE_LOG2 > BUF_SIZE_LOG2 ? MIN_SIZE_LOG2
+                                                 : BUF_SIZE_LOG2 - level;
+  }
+
+  // sin(2 pi i / size), folded into the first quarter wave and evaluated as a
+  // Taylor series so that it works in constant expressions
+  static constexpr f64 get_sine(const u32 i, const u32 size)
+  {
+    const f64 sign = i < size / 2 ? 1. : -1.;
+    u32 j = i % (size / 2);
+    if (j > size / 4) {
+      j = size / 2 - j;
+    }
+    const f64 x = TWOPI * j / size;
+    f64 term = x;
+    f64 sum = x;
+    for (u32 k = 1; k != 12; ++k) {
+      term *= -x * x / f64((2 * k) * (2 * k + 1));
+      sum += term;
+    }
+    return sign * sum;
+  }
+
+  // Where the samples of `level` start
+  static constexpr u32 get_offset(const u32 level)
+  {
+    return level == 0
+      ? GUARD_BEFORE
+      : get_offset(level - 1) + (1u << get_size_log2(level - 1)) +
+        GUARD_AFTER + GUARD_BEFORE;
+  }
+
+  // Halving levels down to MIN_SIZE_LOG2, then the rest at that size, plus
+  // guard points
+  constexpr static u32 TOTAL_SIZE = (2u << BUF_SIZE_LOG2) -
+    (1u << MIN_SIZE_LOG2) +
+    (NUM_LEVELS - 1 - (BUF_SIZE_LOG2 - MIN_SIZE_LOG2)) * (1u << MIN_SIZE_LOG2) +
+    NUM_LEVELS * (GUARD_BEFORE + GUARD_AFTER);
+
+  // Copies the wrapped-around neighbours of `level` into its guard points
+  constexpr void pad(const u32 level)
+  {
+    sample_t* table = buffer + get_offset(level);
+    const u32 size = 1u << get_size_log2(level);
+    table[-1] = table[size - 1];
+    table[size] = table[0];
+    table[size + 1] = table[1];
+  }
 
-  f64 buffer[BUF_SIZE] = {0};
+  // Guard-padded levels back to back, lowest first
+  sample_t buffer[TOTAL_SIZE] = {0};
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "wavetable_bank.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+WavetableBank::WavetableBank(
+  const std::vector<const HarmonicsWavetable*>& wavetables)
+  : num_tables(u32(wavetables.size()))
+{
+  std::shared_ptr<sample_t[]> copy(new sample_t[(num_tables + 1) * STRIDE]);
+  for (u32 i = 0; i <= num_tables; ++i) {
+    const sample_t* table = wavetables[min(i, num_tables - 1)]->get_data();
+    std::copy(table, table + STRIDE, copy.get() + i * STRIDE);
+  }
+  data = copy.get();
+  storage = std::move(copy);
+}
+
+WavetableBank::WavetableBank(
+  const u32 num_tables,
+  std::shared_ptr<const void> storage,
+  const sample_t* data)
+  : num_tables(num_tables), storage(std::move(storage)), data(data)
+{
+}
+
+const WavetableBank::FileHeader
+WavetableBank::get_file_header(const u32 num_tables)
+{
+  FileHeader header = {};
+  std::memcpy(header.magic, "IMPWTBNK", sizeof(header.magic));
+  header.version = FileHeader::VERSION;
+  header.byte_order = FileHeader::BYTE_ORDER_MARK;
+  header.sample_size = sizeof(sample_t);
+  header.num_tables = num_tables;
+  header.table_size = STRIDE;
+  header.num_levels = HarmonicsWavetable::NUM_LEVELS;
+  for (u32 level = 0; level != HarmonicsWavetable::NUM_LEVELS; ++level) {
+    header.level_offsets[level] = HarmonicsWavetable::get_level_offset(level);
+    header.level_size_log2s[level] =
+      HarmonicsWavetable::get_level_size_log2(level);
+  }
+  constexpr u64 ALIGNMENT = FileHeader::DATA_ALIGNMENT;
+  header.data_offset = (sizeof(FileHeader) + ALIGNMENT - 1) / ALIGNMENT *
+    ALIGNMENT;
+  return header;
+}
+
+std::shared_ptr<const WavetableBank> WavetableBank::map(const char* path)
+{
+  std::shared_ptr<const MappedFile> file = MappedFile::open(path);
+  if (!file || file->get_size() < sizeof(FileHeader)) {
+    return nullptr;
+  }
+
+  // Everything but the number of tables is fixed by the build
+  FileHeader header;
+  std::memcpy(&header, file->get_data(), sizeof(FileHeader));
+  const FileHeader expected = get_file_header(header.num_tables);
+  if (
+    header.num_tables == 0 ||
+    std::memcmp(&header, &expected, sizeof(FileHeader)) != 0) {
+    return nullptr;
+  }
+  const u64 data_size = u64(header.num_tables + 1) * STRIDE * sizeof(sample_t);
+  if (file->get_size() < header.data_offset + data_size) {
+    return nullptr;
+  }
+
+  const sample_t* data =
+    reinterpret_cast<const sample_t*>(file->get_data() + header.data_offset);
+  return std::shared_ptr<const WavetableBank>(
+    new WavetableBank(header.num_tables, std::move(file), data));
+}
+
+const bool WavetableBank::save(const char* path) const
+{
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  const FileHeader header = get_file_header(num_tables);
+  const u8 padding[FileHeader::DATA_ALIGNMENT] = {};
+  const size_t num_samples = size_t(num_tables + 1) * STRIDE;
+  const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+    fwrite(padding, 1, header.data_offset - sizeof(header), file) ==
+      header.data_offset - sizeof(header) &&
+    fwrite(data, sizeof(sample_t), num_samples, file) == num_samples;
+  return fclose(file) == 0 && written;
+}
+
+const WavetableBank::Morph WavetableBank::get_morph(
+  const SimdSample::Tables& tables,
+  const sample_t* positions) const
+{
+  Morph morph;
+  morph.tables = tables;
+  alignas(SimdSample::ALIGNMENT) sample_t mix[SimdSample::WIDTH];
+  for (u32 lane = 0; lane != SimdSample::WIDTH; ++lane) {
+    const sample_t position =
+      clamp(sample_t(0), sample_t(num_tables - 1), positions[lane]);
+    const u32 table_ix = u32(position);
+    morph.tables.offset[lane] += table_ix * STRIDE;
+    mix[lane] = position - sample_t(table_ix);
+  }
+  morph.mix = SimdSample::load(mix);
+  return morph;
+}
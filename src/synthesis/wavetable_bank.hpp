@@ -0,0 +1,95 @@
+#ifndef IMP_WAVETABLE_BANK
+#define IMP_WAVETABLE_BANK
+
+#include "constants.hpp"
+#include "simd.hpp"
+#include "wavetable.hpp"
+
+#include <memory>
+#include <vector>
+
+// Wavetables to morph between. A voice at position p, in [0, number of tables
+// - 1], crossfades tables floor(p) and floor(p) + 1 at the same mip level. The
+// tables are stored back to back, so that every SIMD lane can read its own
+// pair with one gather each.
+//
+// Banks can be saved to and mapped from files, which hold the tables exactly
+// as they are laid out in memory: a FileHeader, then the tables at
+// FileHeader::data_offset. Mapped banks are used in place, so loading one only
+// pages it in, and processes mapping the same file share its pages. Files are
+// specific to the byte order and sample_t of the build that saved them.
+class WavetableBank {
+public:
+  // Per lane tables and crossfade amounts, for `sample`
+  struct Morph {
+    SimdSample::Tables tables; // of the lower table of each pair
+    SimdSample mix;            // 0 plays the lower table, 1 the upper one
+  };
+
+  struct FileHeader {
+    static constexpr u32 VERSION = 1;
+    static constexpr u32 BYTE_ORDER_MARK = 0x01020304;
+    static constexpr u32 DATA_ALIGNMENT = 64;
+
+    char magic[8]; // "IMPWTBNK"
+    u32 version;
+    u32 byte_order; // BYTE_ORDER_MARK as the saving host stores it
+    u32 sample_size;
+    u32 num_tables;
+    u32 table_size; // samples, see HarmonicsWavetable::get_data_size
+    u32 num_levels;
+    u32 level_offsets[HarmonicsWavetable::NUM_LEVELS];
+    u32 level_size_log2s[HarmonicsWavetable::NUM_LEVELS];
+    u64 data_offset; // bytes, a multiple of DATA_ALIGNMENT
+  };
+
+  // Copies `wavetables`, of which there must be at least one
+  explicit WavetableBank(
+    const std::vector<const HarmonicsWavetable*>& wavetables);
+
+  // Maps the bank saved at `path`. Returns null if it could not be mapped or
+  // is not a bank this build can read.
+  static std::shared_ptr<const WavetableBank> map(const char* path);
+
+  const bool save(const char* path) const;
+
+  const u32 get_num_tables() const { return num_tables; }
+
+  // Morph of voices at `positions`, one per lane, reading `tables` (see
+  // HarmonicsWavetable::get_tables)
+  const Morph
+  get_morph(const SimdSample::Tables& tables, const sample_t* positions) const;
+
+  // Two lookups and a lerp per lane
+  template <typename Kernel = WavetableKernel>
+  const SimdSample
+  sample(const Morph& morph, const SimdSample::Phase& phase) const
+  {
+    SimdSample::Index ix;
+    SimdSample t;
+    SimdSample::locate(morph.tables, phase, ix, t);
+    const SimdSample a = Kernel::gather(data, ix, t);
+    const SimdSample b = Kernel::gather(data + STRIDE, ix, t);
+    return a + morph.mix * (b - a);
+  }
+
+private:
+  static constexpr u32 STRIDE = HarmonicsWavetable::get_data_size();
+
+  WavetableBank(
+    const u32 num_tables,
+    std::shared_ptr<const void> storage,
+    const sample_t* data);
+
+  // Header this build writes for `num_tables` tables
+  static const FileHeader get_file_header(const u32 num_tables);
+
+  u32 num_tables;
+  // Owns `data`: a copy or a file mapping
+  std::shared_ptr<const void> storage;
+  // One more table than given, repeating the last one, so that the highest
+  // position reads a valid upper table
+  const sample_t* data;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef IMP_WAVETABLE_KERNELS
+#define IMP_WAVETABLE_KERNELS
+
+#include "constants.hpp"
+#include "simd.hpp"
+
+// Interpolation kernels of wavetable lookups, picked at compile time through
+// WavetableKernel. Each reads up to 4 taps, from the sample before to the
+// second sample after the phase, out of tables padded with guard points so that
+// no tap needs wrapping. `y` points at the first tap (the sample before), `t`
+// is how far past the second tap the phase is.
+//
+// `sample` reads one table, `gather` the table of every SIMD lane, with `ix`
+// indexing the first taps in `buffer`.
+
+// `value` in every lane of `V`, which is f64 or SimdSample
+template <typename V>
+inline const V splat(const f64 value)
+{
+  return V::broadcast(sample_t(value));
+}
+
+template <>
+inline const f64 splat<f64>(const f64 value)
+{
+  return value;
+}
+
+// Nearest sample at or before the phase
+struct NearestKernel {
+  template <typename V>
+  static const V interpolate(const V, const V y0, const V, const V, const V)
+  {
+    return y0;
+  }
+
+  static const f64 sample(const sample_t* y, const f64 t)
+  {
+    return interpolate<f64>(0., y[1], 0., 0., t);
+  }
+
+  static const SimdSample gather(
+    const sample_t* buffer,
+    const SimdSample::Index& ix,
+    const SimdSample t)
+  {
+    return SimdSample::gather(buffer + 1, ix);
+  }
+};
+
+struct LinearKernel {
+  template <typename V>
+  static const V
+  interpolate(const V, const V y0, const V y1, const V, const V t)
+  {
+    return (splat<V>(1.) - t) * y0 + t * y1; // precise lerp, like `lerp`
+  }
+
+  static const f64 sample(const sample_t* y, const f64 t)
+  {
+    return interpolate<f64>(0., y[1], y[2], 0., t);
+  }
+
+  static const SimdSample gather(
+    const sample_t* buffer,
+    const SimdSample::Index& ix,
+    const SimdSample t)
+  {
+    const SimdSample y0 = SimdSample::gather(buffer + 1, ix);
+    const SimdSample y1 = SimdSample::gather(buffer + 2, ix);
+    return interpolate(y0, y0, y1, y1, t);
+  }
+};
+
+// Catmull-Rom spline, continuous in slope
+struct HermiteKernel {
+  template <typename V>
+  static const V
+  interpolate(const V ym1, const V y0, const V y1, const V y2, const V t)
+  {
+    const V c1 = splat<V>(.5) * (y1 - ym1);
+    const V c2 = ym1 - splat<V>(2.5) * y0 + splat<V>(2.) * y1 -
+      splat<V>(.5) * y2;
+    const V c3 = splat<V>(.5) * (y2 - ym1) + splat<V>(1.5) * (y0 - y1);
+    return ((c3 * t + c2) * t + c1) * t + y0;
+  }
+
+  static const f64 sample(const sample_t* y, const f64 t)
+  {
+    return interpolate<f64>(y[0], y[1], y[2], y[3], t);
+  }
+
+  static const SimdSample gather(
+    const sample_t* buffer,
+    const SimdSample::Index& ix,
+    const SimdSample t)
+  {
+    return interpolate(
+      SimdSample::gather(buffer, ix),
+      SimdSample::gather(buffer + 1, ix),
+      SimdSample::gather(buffer + 2, ix),
+      SimdSample::gather(buffer + 3, ix),
+      t);
+  }
+};
+
+// Cubic through all 4 taps
+struct LagrangeKernel {
+  template <typename V>
+  static const V
+  interpolate(const V ym1, const V y0, const V y1, const V y2, const V t)
+  {
+    const V tp1 = t + splat<V>(1.);
+    const V tm1 = t - splat<V>(1.);
+    const V tm2 = t - splat<V>(2.);
+    return splat<V>(-1. / 6.) * t * tm1 * tm2 * ym1 +
+      splat<V>(.5) * tp1 * tm1 * tm2 * y0 +
+      splat<V>(-.5) * tp1 * t * tm2 * y1 +
+      splat<V>(1. / 6.) * tp1 * t * tm1 * y2;
+  }
+
+  static const f64 sample(const sample_t* y, const f64 t)
+  {
+    return interpolate<f64>(y[0], y[1], y[2], y[3], t);
+  }
+
+  static const SimdSample gather(
+    const sample_t* buffer,
+    const SimdSample::Index& ix,
+    const SimdSample t)
+  {
+    return interpolate(
+      SimdSample::gather(buffer, ix),
+      SimdSample::gather(buffer + 1, ix),
+      SimdSample::gather(buffer + 2, ix),
+      SimdSample::gather(buffer + 3, ix),
+      t);
+  }
+};
+
+// Set through IMP_WAVETABLE_INTERPOLATION in CMake
+#if defined(IMP_WAVETABLE_NONE)
+using WavetableKernel = NearestKernel;
+#elif defined(IMP_WAVETABLE_HERMITE)
+using WavetableKernel = HermiteKernel;
+#elif defined(IMP_WAVETABLE_LAGRANGE)
+using WavetableKernel = LagrangeKernel;
+#else
+using WavetableKernel = LinearKernel;
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef IMP_WAVETABLE_PRESETS
+#define IMP_WAVETABLE_PRESETS
+
+#include "wavetable.hpp"
+
+// Standard wavetables, baked into the binary at compile time
+
+inline constexpr HarmonicsWavetable SINE_WAVETABLE =
+  HarmonicsWavetable::bake({1.});
+
+inline constexpr f64 VIOLIN_HARMONICS[] = {
+  1., .75, .65, .55, .5, .45, .4, .35, .3, .25, .25, .2};
+
+inline constexpr HarmonicsWavetable VIOLIN_WAVETABLE =
+  HarmonicsWavetable::bake(VIOLIN_HARMONICS);
+
+inline constexpr HarmonicsWavetable SAW_WAVETABLE =
+  HarmonicsWavetable::bake([](const u32 k) { return 1. / k; });
+
+inline constexpr HarmonicsWavetable SQUARE_WAVETABLE = HarmonicsWavetable::bake(
+  [](const u32 k) { return k % 2 == 1 ? 1. / k : .0; });
+
+#endif
@@ -0,0 +1,51 @@
+#include "wavetable_registry.hpp"
+
+template <typename Create>
+const WavetableRegistry::Handle
+WavetableRegistry::acquire_impl(
+  const std::vector<f64>& harmonics,
+  Create create)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // Forget tables whose last handle is gone
+  for (auto it = tables.begin(); it != tables.end();) {
+    it = it->second.expired() ? tables.erase(it) : std::next(it);
+  }
+
+  std::weak_ptr<const HarmonicsWavetable>& entry = tables[harmonics];
+  Handle handle = entry.lock();
+  if (!handle) {
+    handle = create();
+    entry = handle;
+  }
+  return handle;
+}
+
+const WavetableRegistry::Handle
+WavetableRegistry::acquire(const std::vector<f64>& harmonics)
+{
+  return acquire_impl(harmonics, [&harmonics]() {
+    return std::make_shared<const HarmonicsWavetable>(harmonics);
+  });
+}
+
+const WavetableRegistry::Handle WavetableRegistry::acquire(
+  const std::vector<f64>& harmonics,
+  const HarmonicsWavetable& baked)
+{
+  return acquire_impl(harmonics, [&baked]() {
+    // Baked tables are never freed, so the handle only counts references
+    return Handle(&baked, [](const HarmonicsWavetable*) {});
+  });
+}
+
+const size_t WavetableRegistry::get_num_tables()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t num_tables = 0;
+  for (const auto& table : tables) {
+    num_tables += !table.second.expired();
+  }
+  return num_tables;
+}
@@ -0,0 +1,41 @@
+#ifndef IMP_WAVETABLE_REGISTRY
+#define IMP_WAVETABLE_REGISTRY
+
+#include "constants.hpp"
+#include "wavetable.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Interns wavetables by harmonic content, so that every synth playing the same
+// harmonics shares one table. A table lives as long as a handle to it does.
+//
+// NOTE: Handles are not synchronized; assign a synth's handle before the audio
+// thread reads it, or swap synths through a Command
+class WavetableRegistry {
+public:
+  using Handle = std::shared_ptr<const HarmonicsWavetable>;
+
+  // The table of `harmonics`, built only if no live handle already has it
+  const Handle acquire(const std::vector<f64>& harmonics);
+
+  // The table of `harmonics`, backed by `baked` (e.g. a preset, which must
+  // hold exactly `harmonics`) rather than a copy if no live handle has it yet
+  const Handle
+  acquire(const std::vector<f64>& harmonics, const HarmonicsWavetable& baked);
+
+  // Tables with live handles
+  const size_t get_num_tables();
+
+private:
+  template <typename Create>
+  const Handle
+  acquire_impl(const std::vector<f64>& harmonics, Create create);
+
+  std::mutex mutex;
+  std::map<std::vector<f64>, std::weak_ptr<const HarmonicsWavetable>> tables;
+};
+
+#endif
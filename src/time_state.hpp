@@ -6,28 +6,69 @@
 constexpr f64 SAMPLE_FREQUENCY = 44100.;
 constexpr f64 SAMPLE_DURATION = 1. / SAMPLE_FREQUENCY;
 
+// Besides seconds, scaled time is counted in integer ticks of 1/TICKS_PER_FRAME
+// frames, so that events can be scheduled at exact, drift-free timestamps
+//
 // TODO (style): remove get_ naming
 class TimeState {
 public:
+  static constexpr u64 TICKS_PER_FRAME = 1 << 16;
+
+  // Rounds scaled `seconds` to ticks
+  static const u64 to_ticks(const f64 seconds)
+  {
+    return u64(seconds * SAMPLE_FREQUENCY * TICKS_PER_FRAME + .5);
+  }
+
+  const u64 get_frame() const { return frame; }
+  const u64 get_tick() const { return tick_count; }
   const f64 get_absolute_time() const { return absolute_time; }
   const f64 get_scaled_time() const { return scaled_time; }
   const f64 get_scaled_delta_time() const { return scaled_delta_time; }
   const f64 get_time_scale() const { return time_scale; }
 
-  // TODO (feat): interpolatable
+  // Returns how many frames to tick until reaching `tick`, or ~0 if time is
+  // stopped
+  const u64 get_frames_until(const u64 tick) const
+  {
+    if (tick <= tick_count) {
+      return 0;
+    }
+    if (tick_increment == 0) {
+      return ~u64(0);
+    }
+    return (tick - tick_count + tick_increment - 1) / tick_increment;
+  }
+
+  // NOTE: constant within a block, as spans rely on a fixed tick increment.
+  // The Renderer smooths changes across blocks.
   void set_time_scale(const f64 new_time_scale)
   {
     time_scale = new_time_scale;
     scaled_delta_time = time_scale * SAMPLE_DURATION;
+    tick_increment = u64(time_scale * TICKS_PER_FRAME + .5);
   }
 
   void tick()
   {
+    ++frame;
+    tick_count += tick_increment;
     absolute_time += SAMPLE_DURATION;
     scaled_time += scaled_delta_time;
   }
 
+  void tick(const u32 num_frames)
+  {
+    frame += num_frames;
+    tick_count += num_frames * tick_increment;
+    absolute_time += num_frames * SAMPLE_DURATION;
+    scaled_time += num_frames * scaled_delta_time;
+  }
+
 private:
+  u64 frame = 0;
+  u64 tick_count = 0;
+  u64 tick_increment = TICKS_PER_FRAME;
   f64 absolute_time = .0;
   f64 scaled_time = .0;
   f64 scaled_delta_time = SAMPLE_DURATION;